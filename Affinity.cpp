@@ -0,0 +1,152 @@
+#include "Affinity.h"
+#include <algorithm>
+#include <sstream>
+#include <thread>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fstream>
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace {
+
+#ifndef _WIN32
+// Parses a sysfs cpulist such as "0-7,16-23".
+std::vector<int> parseCpuList(const std::string& list) {
+    std::vector<int> cpus;
+    std::stringstream ss(list);
+    std::string range;
+    while (std::getline(ss, range, ',')) {
+        if (range.empty()) continue;
+        size_t dash = range.find('-');
+        int first = std::stoi(range.substr(0, dash));
+        int last = (dash == std::string::npos) ? first : std::stoi(range.substr(dash + 1));
+        for (int cpu = first; cpu <= last; ++cpu) {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+#endif
+
+std::vector<Affinity::HostCpu> detectTopology() {
+    std::vector<Affinity::HostCpu> cpus;
+
+#ifdef _WIN32
+    ULONG highest_node = 0;
+    if (GetNumaHighestNodeNumber(&highest_node)) {
+        for (USHORT node = 0; node <= highest_node; ++node) {
+            ULONGLONG mask = 0;
+            if (!GetNumaNodeProcessorMask(static_cast<UCHAR>(node), &mask)) continue;
+            for (int cpu = 0; cpu < 64; ++cpu) {
+                if (mask & (1ULL << cpu)) {
+                    cpus.push_back({ cpu, node });
+                }
+            }
+        }
+    }
+#else
+    for (int node = 0;; ++node) {
+        std::ifstream cpulist("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+        if (!cpulist.is_open()) break;
+        std::string list;
+        std::getline(cpulist, list);
+        for (int cpu : parseCpuList(list)) {
+            cpus.push_back({ cpu, node });
+        }
+    }
+
+    // Only keep CPUs this process may run on
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0) {
+        if (cpus.empty()) {
+            for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+                if (CPU_ISSET(cpu, &allowed)) cpus.push_back({ cpu, 0 });
+            }
+        }
+        cpus.erase(std::remove_if(cpus.begin(), cpus.end(),
+            [&](const Affinity::HostCpu& c) { return !CPU_ISSET(c.cpu, &allowed); }), cpus.end());
+    }
+#endif
+
+    // No NUMA information: treat the machine as a single node
+    if (cpus.empty()) {
+        int count = std::max(1u, std::thread::hardware_concurrency());
+        for (int cpu = 0; cpu < count; ++cpu) {
+            cpus.push_back({ cpu, 0 });
+        }
+    }
+
+    std::stable_sort(cpus.begin(), cpus.end(),
+        [](const Affinity::HostCpu& a, const Affinity::HostCpu& b) { return a.numa_node < b.numa_node; });
+    return cpus;
+}
+
+}
+
+Affinity::Layout Affinity::parseLayout(const std::string& value) {
+    if (value == "compact") return Layout::Compact;
+    if (value == "spread") return Layout::Spread;
+    return Layout::None;
+}
+
+const char* Affinity::layoutName(Layout layout) {
+    switch (layout) {
+    case Layout::Compact: return "compact";
+    case Layout::Spread: return "spread";
+    default: return "none";
+    }
+}
+
+const std::vector<Affinity::HostCpu>& Affinity::topology() {
+    static const std::vector<HostCpu> cpus = detectTopology();
+    return cpus;
+}
+
+int Affinity::numaNodeCount() {
+    int nodes = 0;
+    for (const auto& c : topology()) {
+        nodes = std::max(nodes, c.numa_node + 1);
+    }
+    return nodes;
+}
+
+Affinity::HostCpu Affinity::placeCore(int core_id, Layout layout) {
+    const auto& cpus = topology();
+    if (layout == Layout::None || cpus.empty()) {
+        return { -1, -1 };
+    }
+
+    if (layout == Layout::Compact) {
+        return cpus[core_id % cpus.size()];
+    }
+
+    // Spread: core i goes to node (i % nodes), taking that node's CPUs in order
+    int nodes = numaNodeCount();
+    int node = core_id % nodes;
+    std::vector<HostCpu> node_cpus;
+    for (const auto& c : cpus) {
+        if (c.numa_node == node) node_cpus.push_back(c);
+    }
+    if (node_cpus.empty()) {
+        return cpus[core_id % cpus.size()];
+    }
+    return node_cpus[(core_id / nodes) % node_cpus.size()];
+}
+
+bool Affinity::pinCurrentThread(int cpu) {
+    if (cpu < 0) return false;
+#ifdef _WIN32
+    if (cpu >= 64) return false;
+    return SetThreadAffinityMask(GetCurrentThread(), static_cast<DWORD_PTR>(1ULL << cpu)) != 0;
+#else
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#endif
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include <string>
+#include <vector>
+
+// Maps emulated cores onto host CPUs and pins worker threads to them.
+class Affinity {
+public:
+    enum class Layout {
+        None,     // Leave threads to the host OS scheduler
+        Compact,  // Fill one NUMA node before moving to the next
+        Spread    // Round-robin cores across NUMA nodes
+    };
+
+    struct HostCpu {
+        int cpu;
+        int numa_node;
+    };
+
+    static Layout parseLayout(const std::string& value);
+    static const char* layoutName(Layout layout);
+
+    // Host CPUs ordered by NUMA node, detected once.
+    static const std::vector<HostCpu>& topology();
+    static int numaNodeCount();
+
+    // Host CPU for an emulated core, or { -1, -1 } when the layout is None.
+    static HostCpu placeCore(int core_id, Layout layout);
+
+    // Pins the calling thread to a host CPU. Returns false if the host refused.
+    static bool pinCurrentThread(int cpu);
+};
@@ -0,0 +1,417 @@
+#include "BatchRunner.h"
+#include "Config.h"
+#include "FCFSScheduler.h"
+#include "RRScheduler.h"
+#include "MemoryManager.h"
+#include "Interpreter.h"
+#include "Metrics.h"
+#include "Process.h"
+#include "ProcessGenerator.h"
+#include "Tracer.h"
+#include <atomic>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <shared_mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace {
+
+constexpr size_t MAX_BURST = 1024; // Generated arrivals submitted per wakeup at most
+
+struct BatchOptions {
+    std::string config_path = "config.txt";
+    std::string trace_path;
+    std::string output_path; // stdout when empty
+    std::string events_path; // Chrome trace-event JSON of the run; off when empty
+    double duration = 0;     // seconds; 0 means "until the trace drains"
+    long long seed = -1;     // Program generator seed; random when negative
+};
+
+struct TraceEntry {
+    long long arrival_ms;
+    int instructions;
+    size_t memory;
+    std::string group; // CPU group name; empty for the first group
+};
+
+bool parseOptions(int argc, char* argv[], BatchOptions& options) {
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            std::cerr << "Missing value for " << arg << "\n";
+            return false;
+        }
+        std::string value = argv[++i];
+        if (arg == "--config") options.config_path = value;
+        else if (arg == "--trace") options.trace_path = value;
+        else if (arg == "--output") options.output_path = value;
+        else if (arg == "--events") options.events_path = value;
+        else if (arg == "--duration") {
+            try {
+                options.duration = std::stod(value);
+            }
+            catch (const std::exception&) {
+                std::cerr << "Invalid value for --duration: " << value << "\n";
+                return false;
+            }
+        }
+        else if (arg == "--seed") {
+            try {
+                options.seed = std::stoll(value);
+            }
+            catch (const std::exception&) {
+                std::cerr << "Invalid value for --seed: " << value << "\n";
+                return false;
+            }
+        }
+        else {
+            std::cerr << "Unknown batch option: " << arg << "\n";
+            return false;
+        }
+    }
+    if (options.duration <= 0 && options.trace_path.empty()) {
+        std::cerr << "Batch mode needs --duration, --trace or both.\n";
+        return false;
+    }
+    return true;
+}
+
+bool loadTrace(const std::string& path, std::vector<TraceEntry>& trace) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        std::cerr << "Failed to open trace \"" << path << "\"\n";
+        return false;
+    }
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        std::stringstream ss(line);
+        TraceEntry entry{};
+        if (ss >> entry.arrival_ms >> entry.instructions >> entry.memory) {
+            ss >> entry.group;
+            trace.push_back(entry);
+        }
+    }
+    std::stable_sort(trace.begin(), trace.end(),
+        [](const TraceEntry& a, const TraceEntry& b) { return a.arrival_ms < b.arrival_ms; });
+    return true;
+}
+
+// Nearest-rank percentile of sorted values, the rule LatencyHistogram uses.
+double percentile(const std::vector<double>& sorted, double p) {
+    if (sorted.empty()) return 0.0;
+    size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * sorted.size()));
+    return sorted[std::clamp<size_t>(rank, 1, sorted.size()) - 1];
+}
+
+template <typename Scheduler>
+int runWorkload(Scheduler& scheduler, const Config::ConfigParameters& config, MemoryManager& memory,
+                const BatchOptions& options, const std::vector<TraceEntry>& trace) {
+    scheduler.SetCpuCore(config.num_cpu);
+    scheduler.SetTotalMemory(config.max_overall_mem);
+    scheduler.SetAffinity(Affinity::parseLayout(config.cpu_affinity));
+    scheduler.SetDomains(config.scheduler_domains, config.balance_threshold, config.balance_interval_ms);
+    scheduler.SetCpuGroups(config.cpu_groups, config.cpu_quota_period_ms);
+    scheduler.SetSoftAffinity(config.affinity_window_ms, config.migration_penalty_cycles);
+    scheduler.SetMemoryManager(&memory);
+    if constexpr (std::is_same_v<Scheduler, RR_Scheduler>) {
+        scheduler.SetQuantum(config.quantum_cycles);
+        scheduler.SetAdaptiveQuantum(QuantumController::fromConfig(config));
+    }
+    CycleClock::Settings clock{ config.clock_mode == "lockstep", static_cast<uint64_t>(config.clock_sync_ticks), config.clock_hz, config.clock_pace == "fast" };
+    scheduler.SetClock(clock);
+    scheduler.SetCoreRuntime(config.core_runtime == "coroutines", config.host_threads);
+    scheduler.SetSleepTick(std::chrono::microseconds(config.sleep_tick_us));
+
+    std::mt19937 gen(options.seed >= 0 ? static_cast<std::mt19937::result_type>(options.seed) : std::random_device{}());
+    std::atomic<size_t> submitted{ 0 }; // Written by the clock step in lockstep mode
+    bool has_deadline = options.duration > 0;
+
+    // Traced processes name their CPU group, generated ones are dealt round the groups
+    std::vector<CpuGroups::Spec> groups;
+    CpuGroups::parse(config.cpu_groups, groups);
+    std::vector<int> trace_groups;
+    for (const TraceEntry& entry : trace) {
+        trace_groups.push_back(CpuGroups::find(groups, entry.group));
+    }
+    auto next_group = [&] { return static_cast<int>((submitted.load() - 1) % groups.size()); };
+
+    ArrivalModel::Kind arrival_model = ArrivalModel::Kind::Constant;
+    ArrivalModel::parseKind(config.arrival_model, arrival_model);
+    // Generates processes on its own producer threads when cores run free
+    std::atomic<int> generated{ 0 };
+    std::shared_mutex table_guard; // Nothing needs the process table still during a batch run
+    ProcessGenerator generator([&](std::span<Process* const> burst) { scheduler.add_processes(burst); }, table_guard, generated);
+    bool generating = !clock.lockstep && trace.empty();
+
+    if (clock.lockstep) {
+        // Arrivals are generated by the clock step in cycle time rather than by
+        // this thread in wall time, so the whole run is reproducible
+        auto to_cycles = [&](double seconds) { return static_cast<uint64_t>(seconds * config.clock_hz); };
+        uint64_t interval = std::max<uint64_t>(1, to_cycles(config.batch_process_freq));
+        // One arrival stream in cycles; constant arrivals land on exact multiples of the interval
+        ArrivalModel arrival_times(arrival_model, static_cast<double>(interval),
+            static_cast<double>(to_cycles(config.burst_on_ms / 1000.0)), static_cast<double>(to_cycles(config.burst_off_ms / 1000.0)));
+        double first_arrival = arrival_times.next(gen);
+        scheduler.SetArrivalSource([&, arrival_times, next = size_t{ 0 }, next_cycle = first_arrival](uint64_t cycle, std::vector<Process*>& arrivals) mutable {
+            if (!trace.empty()) {
+                for (; next < trace.size() && to_cycles(trace[next].arrival_ms / 1000.0) <= cycle; ++next) {
+                    arrivals.push_back(new Process("process" + std::to_string(++submitted), trace[next].instructions, trace[next].memory, gen));
+                    arrivals.back()->group = trace_groups[next];
+                }
+                return;
+            }
+            for (; next_cycle <= static_cast<double>(cycle) && arrivals.size() < MAX_BURST; next_cycle = arrival_times.next(gen)) {
+                int instructions = std::uniform_int_distribution<>(config.min_ins, config.max_ins)(gen);
+                size_t size = std::uniform_int_distribution<size_t>(config.min_mem_per_proc, config.max_mem_per_proc)(gen);
+                arrivals.push_back(new Process("process" + std::to_string(++submitted), instructions, size, gen));
+                arrivals.back()->group = next_group();
+            }
+        }, has_deadline ? to_cycles(options.duration) : 0);
+    }
+
+    uint64_t instructions_before = Interpreter::getInstructionsExecuted();
+    size_t faults_before = memory.getPageFaults();
+
+    if (!options.events_path.empty()) {
+        Tracer::start();
+    }
+    scheduler.start();
+
+    // Optional live metrics while the run is in progress
+    MetricsExporter exporter([&](MetricsWriter& out) {
+        scheduler.collectMetrics(out);
+        memory.collectMetrics(out);
+        if (generating) {
+            generator.collectMetrics(out);
+        }
+    });
+    if (config.metrics_port != 0 && !exporter.serveHttp(config.metrics_port)) {
+        std::cerr << "Could not listen on metrics port " << config.metrics_port << "\n";
+    }
+    if (!config.metrics_file.empty()) {
+        exporter.writeFile(config.metrics_file, config.metrics_interval);
+    }
+
+    auto begin = std::chrono::steady_clock::now();
+    auto elapsed = [&] { return std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count(); };
+    // Rejected processes never run, so they count as done for the drain
+    auto done = [&] { return scheduler.getFinishedCount() + scheduler.getRejectedCount(); };
+
+    // Arrivals that are due together are submitted with one add_processes call
+    std::vector<Process*> burst;
+    if (clock.lockstep) {
+        // The clock stops itself at the deadline; a trace without one runs until it drains
+        while (!scheduler.isClockStopped() && (has_deadline || submitted.load() < trace.size() || done() < submitted.load())) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    }
+    else if (!trace.empty()) {
+        auto past_deadline = [&](const TraceEntry& entry) {
+            return has_deadline && std::chrono::milliseconds(entry.arrival_ms) > std::chrono::duration<double>(options.duration);
+        };
+        size_t next = 0;
+        while (next < trace.size() && !past_deadline(trace[next])) {
+            std::this_thread::sleep_until(begin + std::chrono::milliseconds(trace[next].arrival_ms));
+            auto now = std::chrono::steady_clock::now();
+            burst.clear();
+            for (; next < trace.size() && !past_deadline(trace[next]) && begin + std::chrono::milliseconds(trace[next].arrival_ms) <= now; ++next) {
+                burst.push_back(new Process("process" + std::to_string(++submitted), trace[next].instructions, trace[next].memory, gen));
+                burst.back()->group = trace_groups[next];
+            }
+            scheduler.add_processes(burst);
+        }
+        // Drain: wait for every traced process unless a deadline cuts it short
+        while (done() < submitted.load() && (!has_deadline || elapsed() < options.duration)) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    }
+    else {
+        generator.start(ProcessGenerator::fromConfig(config, static_cast<int>(groups.size()), options.seed));
+        std::this_thread::sleep_until(begin + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(options.duration)));
+        generator.stop();
+        submitted = generator.generated();
+    }
+
+    // Sample before stopping so shutdown does not skew the numbers
+    double wall = elapsed();
+    uint64_t instructions = Interpreter::getInstructionsExecuted() - instructions_before;
+    size_t faults = memory.getPageFaults() - faults_before;
+    size_t finished = scheduler.getFinishedCount();
+    size_t pending = scheduler.getPendingCount();
+    size_t rejected = scheduler.getRejectedCount();
+    uint64_t cycles = scheduler.getCycle();
+    std::vector<double> turnaround = scheduler.getTurnaroundTimes();
+    const SchedulerLatency& latency = scheduler.getLatency();
+    // In lockstep cores spend most host time at the barrier, so utilization
+    // is the share of emulated cycles they executed; otherwise host busy time
+    std::vector<double> utilization;
+    for (const auto& stats : scheduler.getCoreStats()) {
+        if (clock.lockstep) {
+            double busy = static_cast<double>(stats->busy_cycles.load());
+            utilization.push_back(cycles > 0 ? std::min(busy / static_cast<double>(cycles), 1.0) : 0.0);
+        }
+        else {
+            double busy = static_cast<double>(stats->busy_nanoseconds.load()) / 1e9;
+            utilization.push_back(wall > 0 ? std::min(busy / wall, 1.0) : 0.0);
+        }
+    }
+    exporter.stop();
+    scheduler.stop();
+    if (!options.events_path.empty()) {
+        Tracer::stop();
+        if (!Tracer::writeJson(options.events_path)) {
+            std::cerr << "Failed to write events to \"" << options.events_path << "\"\n";
+        }
+    }
+
+    std::sort(turnaround.begin(), turnaround.end());
+    double average_utilization = 0;
+    for (double u : utilization) average_utilization += u;
+    if (!utilization.empty()) average_utilization /= utilization.size();
+
+    std::ostringstream json;
+    json << std::fixed << std::setprecision(6);
+    json << "{\n";
+    json << "  \"scheduler\": \"" << config.scheduler << "\",\n";
+    json << "  \"allocator\": \"" << (config.max_overall_mem == config.mem_per_frame ? "flat" : "paging") << "\",\n";
+    json << "  \"num_cpu\": " << config.num_cpu << ",\n";
+    json << "  \"wall_seconds\": " << wall << ",\n";
+    json << "  \"processes\": { \"submitted\": " << submitted.load() << ", \"finished\": " << finished << ", \"pending\": " << pending << ", \"rejected\": " << rejected << " },\n";
+    // Per second figures are in host time; lockstep runs add the same per emulated cycle
+    json << "  \"throughput\": { \"time_base\": \"host\", \"processes_per_second\": " << (wall > 0 ? finished / wall : 0)
+         << ", \"instructions_per_second\": " << (wall > 0 ? instructions / wall : 0)
+         << ", \"interpreter_instructions_per_second_per_core\": " << Interpreter::getInstructionsPerSecond();
+    if (clock.lockstep) {
+        json << ", \"processes_per_million_cycles\": " << (cycles > 0 ? finished * 1e6 / static_cast<double>(cycles) : 0)
+             << ", \"instructions_per_cycle\": " << (cycles > 0 ? static_cast<double>(instructions) / static_cast<double>(cycles) : 0);
+    }
+    json << " },\n";
+    json << "  \"utilization\": { \"basis\": \"" << (clock.lockstep ? "cycles" : "host_time") << "\", \"average\": " << average_utilization << ", \"per_core\": [";
+    for (size_t i = 0; i < utilization.size(); ++i) {
+        json << (i ? ", " : "") << utilization[i];
+    }
+    json << "] },\n";
+    json << "  \"turnaround_seconds\": { \"count\": " << turnaround.size()
+         << ", \"p50\": " << percentile(turnaround, 50)
+         << ", \"p90\": " << percentile(turnaround, 90)
+         << ", \"p99\": " << percentile(turnaround, 99)
+         << ", \"max\": " << (turnaround.empty() ? 0.0 : turnaround.back()) << " },\n";
+    for (const auto& [key, histogram] : { std::pair{ "waiting_seconds", &latency.waiting }, std::pair{ "response_seconds", &latency.response } }) {
+        json << "  \"" << key << "\": { \"count\": " << histogram->count()
+             << ", \"p50\": " << histogram->percentile(50) / 1e9
+             << ", \"p90\": " << histogram->percentile(90) / 1e9
+             << ", \"p99\": " << histogram->percentile(99) / 1e9
+             << ", \"p99.9\": " << histogram->percentile(99.9) / 1e9
+             << ", \"max\": " << histogram->max() / 1e9 << " },\n";
+    }
+    if (trace.empty()) {
+        // Lockstep arrivals follow emulated time, so their rate is per emulated second
+        double achieved = generating ? generator.achievedRate()
+            : cycles > 0 ? static_cast<double>(submitted.load()) * config.clock_hz / static_cast<double>(cycles) : 0.0;
+        json << "  \"arrivals\": { \"model\": \"" << config.arrival_model << "\", \"target_per_second\": "
+             << (config.batch_process_freq > 0 ? 1.0 / config.batch_process_freq : 1.0) << ", \"achieved_per_second\": " << achieved << " },\n";
+    }
+    if constexpr (std::is_same_v<Scheduler, RR_Scheduler>) {
+        // The quantum over time, as [seconds, cycles] pairs of each change
+        json << "  \"quantum\": { \"mode\": \"" << config.quantum_mode << "\", \"cycles\": " << scheduler.getQuantum()
+             << ", \"changes\": " << scheduler.getQuantumControl().changes() << ", \"history\": [";
+        const auto& history = scheduler.getQuantumControl().history();
+        for (size_t i = 0; i < history.size(); ++i) {
+            json << (i ? ", " : "") << "[" << history[i].seconds << ", " << history[i].quantum << "]";
+        }
+        json << "] },\n";
+    }
+    json << "  \"domains\": { \"count\": " << scheduler.getDomainCount() << ", \"migrations\": " << scheduler.getMigrations() << " },\n";
+    {
+        // Core migrations: per core from CoreStats, per process from the table
+        uint64_t migrations = 0, home = 0, stalled = 0, moved = 0, most = 0;
+        std::ostringstream per_core;
+        for (size_t i = 0; i < scheduler.getCoreStats().size(); ++i) {
+            const CoreStats& stats = *scheduler.getCoreStats()[i];
+            migrations += stats.migrations_in.load();
+            home += stats.home_dispatches.load();
+            stalled += stats.stall_cycles.load();
+            per_core << (i ? ", " : "") << stats.migrations_in.load();
+        }
+        ProcessTable::Slot rows = ProcessTable::size();
+        for (ProcessTable::Slot slot = 0; slot < rows; ++slot) {
+            moved += ProcessTable::migrations(slot);
+            most = std::max<uint64_t>(most, ProcessTable::migrations(slot));
+        }
+        json << "  \"affinity\": { \"window_ms\": " << config.affinity_window_ms << ", \"penalty_cycles\": " << config.migration_penalty_cycles
+             << ", \"migrations\": " << migrations << ", \"home_dispatches\": " << home << ", \"stall_cycles\": " << stalled
+             << ", \"migrations_per_core\": [" << per_core.str() << "], \"migrations_per_process\": { \"mean\": "
+             << (rows > 0 ? static_cast<double>(moved) / rows : 0.0) << ", \"max\": " << most << " } },\n";
+    }
+    json << "  \"cpu_groups\": [";
+    for (size_t i = 0; i < scheduler.getCpuGroups().size(); ++i) {
+        json << (i ? ", " : "") << "{ \"name\": \"" << scheduler.getCpuGroups().spec(static_cast<int>(i)).name
+             << "\", \"usage_seconds\": " << scheduler.getCpuGroups().usageSeconds(static_cast<int>(i)) << " }";
+    }
+    json << "],\n";
+    if (clock.lockstep) {
+        json << "  \"clock\": { \"mode\": \"lockstep\", \"cycles\": " << cycles
+             << ", \"schedule_hash\": \"" << std::hex << std::setw(16) << std::setfill('0') << scheduler.getScheduleHash()
+             << std::dec << std::setfill(' ') << "\" },\n";
+    }
+    json << "  \"memory\": { \"total_kb\": " << memory.getTotalMemory()
+         << ", \"used_kb\": " << memory.getUsedMemory()
+         << ", \"page_faults\": " << faults
+         << ", \"page_faults_per_second\": " << (wall > 0 ? faults / wall : 0) << " }\n";
+    json << "}\n";
+
+    if (options.output_path.empty()) {
+        std::cout << json.str();
+    }
+    else {
+        std::ofstream out(options.output_path);
+        if (!out.is_open()) {
+            std::cerr << "Failed to open output \"" << options.output_path << "\"\n";
+            return 1;
+        }
+        out << json.str();
+    }
+    return 0;
+}
+
+}
+
+int runBatch(int argc, char* argv[]) {
+    BatchOptions options;
+    if (!parseOptions(argc, argv, options)) {
+        return 2;
+    }
+
+    std::vector<TraceEntry> trace;
+    if (!options.trace_path.empty() && !loadTrace(options.trace_path, trace)) {
+        return 2;
+    }
+
+    Config::Initialize(options.config_path);
+    Config::Snapshot config = Config::Current();
+    std::unique_ptr<MemoryManager> memory(MemoryManager::create(*config));
+
+    if (config->scheduler == "fcfs") {
+        FCFS_Scheduler scheduler(config->num_cpu, config->max_overall_mem);
+        return runWorkload(scheduler, *config, *memory, options, trace);
+    }
+    if (config->scheduler == "rr") {
+        RR_Scheduler scheduler(config->num_cpu, config->quantum_cycles, config->max_overall_mem);
+        return runWorkload(scheduler, *config, *memory, options, trace);
+    }
+    std::cerr << "Config has no valid scheduler.\n";
+    return 2;
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+// Headless mode for scripted performance runs. Loads a config, runs the
+// configured scheduler and allocator against a generated workload or a trace
+// and writes a JSON metrics summary:
+//
+//   csopesy --batch [--config <file>] [--duration <seconds>] [--trace <file>] [--output <file>]
+//                   [--events <file>] [--seed <n>]
+//
+// Without a trace, processes arrive every batch-process-freq seconds for the
+// whole duration. A trace has one process per line, "<arrival-ms> <instructions> <memory-kb>";
+// the run then ends when every traced process finished, or at --duration if given.
+// --seed fixes the generated programs; with clock-mode "lockstep" arrivals are
+// timed in emulated cycles, so a seeded run schedules identically every time.
+int runBatch(int argc, char* argv[]);
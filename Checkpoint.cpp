@@ -0,0 +1,110 @@
+#include "Checkpoint.h"
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+
+namespace {
+
+size_t alignUp(size_t offset) {
+    return (offset + Checkpoint::ALIGNMENT - 1) / Checkpoint::ALIGNMENT * Checkpoint::ALIGNMENT;
+}
+
+}
+
+size_t Checkpoint::Writer::size() const {
+    size_t offset = alignUp(sizeof(Header) + sections.size() * sizeof(SectionEntry));
+    for (const Pending& section : sections) {
+        offset = alignUp(offset + section.bytes());
+    }
+    return offset;
+}
+
+bool Checkpoint::Writer::writeFile(const std::string& path) const {
+    Header header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.sections = static_cast<uint32_t>(sections.size());
+
+    std::vector<SectionEntry> table;
+    table.reserve(sections.size());
+    size_t offset = alignUp(sizeof(Header) + sections.size() * sizeof(SectionEntry));
+    for (const Pending& section : sections) {
+        table.push_back({ static_cast<uint32_t>(section.id), section.record_size, section.count, offset });
+        offset = alignUp(offset + section.bytes());
+    }
+
+    std::string temporary = path + ".tmp";
+    {
+        std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+        if (!out) return false;
+
+        static const char padding[ALIGNMENT] = {};
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(table.data()), static_cast<std::streamsize>(table.size() * sizeof(SectionEntry)));
+        size_t written = sizeof(header) + table.size() * sizeof(SectionEntry);
+        for (size_t i = 0; i < sections.size(); ++i) {
+            out.write(padding, static_cast<std::streamsize>(table[i].offset - written));
+            out.write(sections[i].data, static_cast<std::streamsize>(sections[i].bytes()));
+            written = table[i].offset + sections[i].bytes();
+        }
+        out.write(padding, static_cast<std::streamsize>(offset - written));
+        if (!out.flush()) {
+            out.close();
+            std::remove(temporary.c_str());
+            return false;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporary, path, error);
+    if (error) {
+        std::remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool Checkpoint::Reader::open(const std::string& path, std::string& error) {
+    entries = {};
+    if (!file.open(path)) {
+        error = "cannot read " + path;
+        return false;
+    }
+
+    if (file.size() < sizeof(Header)) {
+        error = "not a checkpoint file";
+        return false;
+    }
+    const Header& header = *reinterpret_cast<const Header*>(file.data());
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0) {
+        error = "not a checkpoint file";
+        return false;
+    }
+    if (header.version != VERSION) {
+        error = "checkpoint format version " + std::to_string(header.version) + ", expected " + std::to_string(VERSION);
+        return false;
+    }
+    if (header.sections > (file.size() - sizeof(Header)) / sizeof(SectionEntry)) {
+        error = "truncated section table";
+        return false;
+    }
+
+    std::span<const SectionEntry> table(reinterpret_cast<const SectionEntry*>(file.data() + sizeof(Header)), header.sections);
+    for (const SectionEntry& entry : table) {
+        bool inside = entry.offset % ALIGNMENT == 0 && entry.offset <= file.size()
+            && entry.record_size > 0 && entry.count <= (file.size() - entry.offset) / entry.record_size;
+        if (!inside) {
+            error = "section " + std::to_string(entry.id) + " runs past the end of the file";
+            return false;
+        }
+    }
+    entries = table;
+    return true;
+}
+
+bool Checkpoint::Reader::has(Section id) const {
+    for (const SectionEntry& entry : entries) {
+        if (entry.id == static_cast<uint32_t>(id)) return true;
+    }
+    return false;
+}
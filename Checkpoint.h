@@ -0,0 +1,184 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <span>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "Platform.h"
+
+// Binary snapshot of the emulator: process table, live processes, scheduler
+// queues and allocator state. A file is a header, a table of sections and the
+// section payloads. Every section is an array of fixed-size records in host
+// byte order, starting on a 64-byte boundary, so a reader maps the file and
+// copies each section straight into place instead of parsing fields. The
+// table stores each section's record size; a build whose records differ
+// ignores the section, and loading then fails instead of misreading it.
+//
+// Each component writes and reads its own sections. A checkpoint is taken
+// with the cores stopped and restored into a stopped scheduler.
+class Checkpoint {
+public:
+    static constexpr char MAGIC[8] = { 'C', 'S', 'O', 'P', 'C', 'K', 'P', 'T' };
+    static constexpr uint32_t VERSION = 7;
+    static constexpr size_t ALIGNMENT = 64;
+
+    // Numbers are part of the file format; never reuse one
+    enum class Section : uint32_t {
+        Info = 1,
+
+        // ProcessTable columns, one record per row
+        TableExecuted = 10,
+        TableTotal = 11,
+        TableCore = 12,
+        TableMemory = 13,
+        TableState = 14,
+        TableArrival = 15,
+        TableStart = 16,
+        TableFinish = 17,
+        TableNameLength = 18,
+        TableNames = 19, // Every name back to back
+        TableMigrations = 20,
+
+        // Processes that have not retired, and their bytecode
+        Processes = 30,
+        Programs = 31,
+
+        // Scheduler queues
+        Scheduler = 40,
+        SchedulerBlocked = 41,  // Ticks left per blocked process
+        SchedulerFinished = 42, // Table slots in completion order
+
+        FlatBlocks = 50,
+
+        PagingInfo = 60,
+        PagingFrames = 61,      // Reference count per frame
+        PagingTables = 62,
+        PagingEntries = 63,
+        PagingResident = 64,
+        PagingBacking = 65
+    };
+
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t sections;
+    };
+
+    struct SectionEntry {
+        uint32_t id;
+        uint32_t record_size;
+        uint64_t count;
+        uint64_t offset; // From the start of the file
+    };
+
+    // What the checkpoint was taken with; restore needs the same scheduler and memory sizes
+    struct Info {
+        char scheduler[8];      // "fcfs" or "rr", zero padded
+        uint64_t max_overall_mem;
+        uint64_t mem_per_frame;
+        uint64_t huge_page_size;
+        int64_t saved_at;       // System clock, nanoseconds since the epoch
+        uint32_t num_cpu;
+        uint32_t rows;          // Process table rows
+    };
+
+    // Queue lengths of a scheduler. The Processes section lists the ready
+    // queue, then the processes waiting for memory, then the blocked ones.
+    struct SchedulerState {
+        uint64_t ready;
+        uint64_t pending;
+        uint64_t blocked;
+        uint64_t cycle;         // Lockstep cycle to resume from
+        uint64_t schedule_hash;
+    };
+
+    // Steady-clock instants do not survive a restart, so they are stored as
+    // their age when the checkpoint was taken and rebased on `now` at restore.
+    // A zero instant (never happened) stays zero.
+    static constexpr int64_t NEVER = INT64_MIN;
+    static int64_t age(std::chrono::steady_clock::time_point instant, std::chrono::steady_clock::time_point now) {
+        if (instant == std::chrono::steady_clock::time_point{}) return NEVER;
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(now - instant).count();
+    }
+    static std::chrono::steady_clock::time_point instant(int64_t age, std::chrono::steady_clock::time_point now) {
+        if (age == NEVER) return {};
+        return now - std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::nanoseconds(age));
+    }
+
+    // Collects sections in memory and writes them out in one go.
+    class Writer {
+    public:
+        // Copies the records
+        template <typename T>
+        void add(Section id, const T* records, size_t count) {
+            static_assert(std::is_trivially_copyable_v<T>, "checkpoint records are copied as bytes");
+            auto bytes = std::make_shared<std::vector<char>>(count * sizeof(T));
+            if (count > 0) {
+                std::memcpy(bytes->data(), records, count * sizeof(T));
+            }
+            sections.push_back({ id, sizeof(T), count, bytes->data(), bytes });
+        }
+        template <typename T>
+        void add(Section id, const std::vector<T>& records) { add(id, records.data(), records.size()); }
+        template <typename T>
+        void add(Section id, const T& record) { add(id, &record, 1); }
+        // Takes the vector over instead of copying it
+        template <typename T>
+        void add(Section id, std::vector<T>&& records) {
+            static_assert(std::is_trivially_copyable_v<T>, "checkpoint records are copied as bytes");
+            auto owned = std::make_shared<std::vector<T>>(std::move(records));
+            sections.push_back({ id, sizeof(T), owned->size(), reinterpret_cast<const char*>(owned->data()), owned });
+        }
+
+        // Writes a temporary file next to `path` and renames it into place,
+        // so a crash mid-write leaves the previous checkpoint intact.
+        bool writeFile(const std::string& path) const;
+        size_t size() const; // Bytes the file will take
+
+    private:
+        struct Pending {
+            Section id;
+            uint32_t record_size;
+            uint64_t count;
+            const char* data;
+            std::shared_ptr<const void> owner; // Keeps data alive
+            size_t bytes() const { return static_cast<size_t>(count) * record_size; }
+        };
+        std::vector<Pending> sections;
+    };
+
+    // Maps a checkpoint file and hands out its sections in place.
+    class Reader {
+    public:
+        // Checks the header and that every section lies inside the file;
+        // `error` says what is wrong otherwise.
+        bool open(const std::string& path, std::string& error);
+
+        // Records of a section. Empty when the section is missing or its
+        // records are not sizeof(T) bytes.
+        template <typename T>
+        std::span<const T> section(Section id) const {
+            for (const SectionEntry& entry : entries) {
+                if (entry.id == static_cast<uint32_t>(id) && entry.record_size == sizeof(T)) {
+                    return { reinterpret_cast<const T*>(file.data() + entry.offset), static_cast<size_t>(entry.count) };
+                }
+            }
+            return {};
+        }
+        // The first record of a section, or nullptr.
+        template <typename T>
+        const T* record(Section id) const {
+            std::span<const T> records = section<T>(id);
+            return records.empty() ? nullptr : records.data();
+        }
+        bool has(Section id) const;
+
+    private:
+        MappedFile file;
+        std::span<const SectionEntry> entries;
+    };
+};
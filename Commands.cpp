@@ -1,6 +1,7 @@
 #include "Commands.h"
 #include "Config.h"
 #include "ConsoleManager.h"
+#include "Platform.h"
 #include <iostream>
 #include <cstdlib>
 #include <sstream>
@@ -22,6 +23,6 @@ void displayHeader() {
 }
 
 void clearScreen() {
-    system("cls");
+    clearConsole();
     displayHeader();
 }
@@ -1,83 +1,273 @@
 #include "Config.h"
+#include "CpuGroups.h"
+#include "ProcessGenerator.h"
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <stdexcept>
 #include <algorithm>
 #include <cmath> 
 
-Config::ConfigParameters Config::config_parameters_;
+std::string Config::path_ = "config.txt";
+std::atomic<Config::Snapshot> Config::current_{ std::make_shared<const Config::ConfigParameters>() };
+std::atomic<uint64_t> Config::generation_{ 0 };
 
-void Config::Initialize() {
-    std::ifstream config_file("config.txt");
+bool Config::Load(const std::string& path, ConfigParameters& params) {
+    std::ifstream config_file(path);
     if (!config_file.is_open()) {
-        std::cout << "Failed to open file \"config.txt\"" << std::endl;
-        return;
+        std::cout << "Failed to open file \"" << path << "\"" << std::endl;
+        return false;
     }
 
-    std::string key_value;
-    while (getline(config_file, key_value)) {
-        // Read line.
-        std::stringstream key_value_stream(key_value);
-        std::string key, value;
-        // Get parameter key and value.
-        key_value_stream >> key >> value;
-        value.erase(std::remove(value.begin(), value.end(), '\"'), value.end());
+    std::string key, value;
+    try {
+        std::string key_value;
+        while (getline(config_file, key_value)) {
+            // Read line.
+            std::stringstream key_value_stream(key_value);
+            key.clear();
+            value.clear();
+            // Get parameter key and value.
+            key_value_stream >> key >> value;
+            value.erase(std::remove(value.begin(), value.end(), '\"'), value.end());
 
-        if (key == "num-cpu") {
-            config_parameters_.num_cpu = std::stoi(value);
-        }
-        else if (key == "scheduler") {
-            if (value == "fcfs" || value == "rr") {
-                config_parameters_.scheduler = value;
+            if (key == "num-cpu") {
+                params.num_cpu = std::stoi(value);
+            }
+            else if (key == "scheduler") {
+                if (value == "fcfs" || value == "rr") {
+                    params.scheduler = value;
+                }
+                else {
+                    std::cout << "Invalid scheduler value: " << value << std::endl;
+                }
+            }
+            else if (key == "quantum-cycles") {
+                params.quantum_cycles = std::stoi(value);
+            }
+            else if (key == "quantum-mode") {
+                if (value == "fixed" || value == "adaptive") {
+                    params.quantum_mode = value;
+                }
+                else {
+                    std::cout << "Invalid quantum-mode value: " << value << std::endl;
+                }
+            }
+            else if (key == "target-response-ms") {
+                params.target_response_ms = std::max(1, std::stoi(value));
+            }
+            else if (key == "quantum-min-cycles") {
+                params.quantum_min_cycles = std::max(1, std::stoi(value));
+            }
+            else if (key == "quantum-max-cycles") {
+                params.quantum_max_cycles = std::max(1, std::stoi(value));
+            }
+            else if (key == "quantum-hysteresis") {
+                params.quantum_hysteresis = std::max(0, std::stoi(value));
+            }
+            else if (key == "batch-process-freq") {
+                params.batch_process_freq = std::stod(value);
+            }
+            else if (key == "min-ins") {
+                params.min_ins = std::stoi(value);
+            }
+            else if (key == "max-ins") {
+                params.max_ins = std::stoi(value);
+            }
+            else if (key == "delay-per-exec") {
+                params.delay_per_exec = std::stod(value);
+            }
+            else if (key == "max-overall-mem") {
+                params.max_overall_mem = std::stoul(value);
+            }
+            else if (key == "mem-per-frame") {
+                params.mem_per_frame = std::stoul(value);
+            }
+            else if (key == "min-mem-per-proc") {
+                params.min_mem_per_proc = std::stoul(value);
+            }
+            else if (key == "max-mem-per-proc") {
+                params.max_mem_per_proc = std::stoul(value);
+            }
+            else if (key == "huge-page-size") {
+                params.huge_page_size = std::stoul(value);
+            }
+            else if (key == "huge-page-threshold") {
+                params.huge_page_threshold = std::stoul(value);
+            }
+            else if (key == "working-set-window") {
+                params.working_set_window = std::clamp(std::stoi(value), 0, 8);
+            }
+            else if (key == "prefetch-pages") {
+                params.prefetch_pages = std::max(0, std::stoi(value));
+            }
+            else if (key == "swapper-free-frames") {
+                params.swapper_free_frames = std::max(0, std::stoi(value));
+            }
+            else if (key == "cpu-affinity") {
+                if (value == "none" || value == "compact" || value == "spread") {
+                    params.cpu_affinity = value;
+                }
+                else {
+                    std::cout << "Invalid cpu-affinity value: " << value << std::endl;
+                }
+            }
+            else if (key == "scheduler-domains") {
+                if (value == "none" || value == "numa" || (!value.empty() && value.find_first_not_of("0123456789") == std::string::npos && std::stoi(value) > 0)) {
+                    params.scheduler_domains = value;
+                }
+                else {
+                    std::cout << "Invalid scheduler-domains value: " << value << std::endl;
+                }
+            }
+            else if (key == "balance-interval-ms") {
+                params.balance_interval_ms = std::max(1, std::stoi(value));
+            }
+            else if (key == "balance-threshold") {
+                params.balance_threshold = std::max(0.0, std::stod(value));
+            }
+            else if (key == "cpu-groups") {
+                std::vector<CpuGroups::Spec> specs;
+                if (CpuGroups::parse(value, specs)) {
+                    params.cpu_groups = value;
+                }
+                else {
+                    std::cout << "Invalid cpu-groups value: " << value << std::endl;
+                }
+            }
+            else if (key == "cpu-quota-period-ms") {
+                params.cpu_quota_period_ms = std::max(1, std::stoi(value));
+            }
+            else if (key == "affinity-window-ms") {
+                params.affinity_window_ms = std::max(0, std::stoi(value));
+            }
+            else if (key == "migration-penalty-cycles") {
+                params.migration_penalty_cycles = std::max(0, std::stoi(value));
+            }
+            else if (key == "arrival-model") {
+                ArrivalModel::Kind kind;
+                if (ArrivalModel::parseKind(value, kind)) {
+                    params.arrival_model = value;
+                }
+                else {
+                    std::cout << "Invalid arrival-model value: " << value << std::endl;
+                }
+            }
+            else if (key == "arrival-threads") {
+                params.arrival_threads = std::max(1, std::stoi(value));
+            }
+            else if (key == "burst-on-ms") {
+                params.burst_on_ms = std::max(0, std::stoi(value));
+            }
+            else if (key == "burst-off-ms") {
+                params.burst_off_ms = std::max(0, std::stoi(value));
+            }
+            else if (key == "metrics-port") {
+                params.metrics_port = std::stoi(value);
+            }
+            else if (key == "metrics-file") {
+                params.metrics_file = value;
+            }
+            else if (key == "metrics-interval") {
+                params.metrics_interval = std::stod(value);
+            }
+            else if (key == "dispatch-batch") {
+                params.dispatch_batch = std::max(1, std::stoi(value));
+            }
+            else if (key == "clock-mode") {
+                if (value == "free" || value == "lockstep") {
+                    params.clock_mode = value;
+                }
+                else {
+                    std::cout << "Invalid clock-mode value: " << value << std::endl;
+                }
+            }
+            else if (key == "clock-hz") {
+                params.clock_hz = std::stod(value);
+            }
+            else if (key == "clock-sync-ticks") {
+                params.clock_sync_ticks = std::max(1, std::stoi(value));
+            }
+            else if (key == "clock-pace") {
+                if (value == "realtime" || value == "fast") {
+                    params.clock_pace = value;
+                }
+                else {
+                    std::cout << "Invalid clock-pace value: " << value << std::endl;
+                }
+            }
+            else if (key == "core-runtime") {
+                if (value == "threads" || value == "coroutines") {
+                    params.core_runtime = value;
+                }
+                else {
+                    std::cout << "Invalid core-runtime value: " << value << std::endl;
+                }
+            }
+            else if (key == "host-threads") {
+                params.host_threads = std::max(0, std::stoi(value));
+            }
+            else if (key == "sleep-tick-us") {
+                params.sleep_tick_us = std::max(1, std::stoi(value));
             }
             else {
-                std::cout << "Invalid scheduler value: " << value << std::endl;
+                std::cout << "Invalid config key: " << key << std::endl;
             }
         }
-        else if (key == "quantum-cycles") {
-            config_parameters_.quantum_cycles = std::stoi(value);
-        }
-        else if (key == "batch-process-freq") {
-            config_parameters_.batch_process_freq = std::stod(value);
-        }
-        else if (key == "min-ins") {
-            config_parameters_.min_ins = std::stoi(value);
-        }
-        else if (key == "max-ins") {
-            config_parameters_.max_ins = std::stoi(value);
-        }
-        else if (key == "delay-per-exec") {
-            config_parameters_.delay_per_exec = std::stod(value);
-        }
-        else if (key == "max-overall-mem") {
-            config_parameters_.max_overall_mem = std::stoul(value);
-        }
-        else if (key == "mem-per-frame") {
-            config_parameters_.mem_per_frame = std::stoul(value);
-        }
-        else if (key == "min-mem-per-proc") {
-            config_parameters_.min_mem_per_proc = std::stoul(value);
-        }
-        else if (key == "max-mem-per-proc") {
-            config_parameters_.max_mem_per_proc = std::stoul(value);
-        }
-        else {
-            std::cout << "Invalid config key: " << key << std::endl;
-        }
+    }
+    catch (const std::exception&) {
+        // stoi and friends throw on a value that is not a number or out of range
+        std::cout << "Invalid " << key << " value: " << value << std::endl;
+        return false;
     }
 
 
-    if (config_parameters_.max_overall_mem == 0 || config_parameters_.mem_per_frame == 0) {
+    if (params.max_overall_mem == 0 || params.mem_per_frame == 0) {
         std::cerr << "Invalid configuration: max-overall-mem and mem-per-frame must be non-zero." << std::endl;
-        std::exit(EXIT_FAILURE); // Exit the program if critical parameters are invalid
+        return false;
     }
 
-    if (config_parameters_.max_overall_mem % config_parameters_.mem_per_frame != 0) {
+    if (params.max_overall_mem % params.mem_per_frame != 0) {
         std::cerr << "Invalid configuration: max-overall-mem must be a multiple of mem-per-frame." << std::endl;
-        std::exit(EXIT_FAILURE);
+        return false;
+    }
+
+    if (params.huge_page_size != 0 && (params.huge_page_size <= params.mem_per_frame || params.huge_page_size % params.mem_per_frame != 0
+        || params.huge_page_size > params.max_overall_mem)) {
+        std::cerr << "Invalid configuration: huge-page-size must be a multiple of mem-per-frame, larger than it and no larger than max-overall-mem." << std::endl;
+        return false;
     }
+
+    return true;
+}
+
+void Config::Publish(const ConfigParameters& params) {
+    current_.store(std::make_shared<const ConfigParameters>(params), std::memory_order_release);
+    generation_.fetch_add(1, std::memory_order_acq_rel);
+}
+
+void Config::Initialize(const std::string& path) {
+    path_ = path;
+    ConfigParameters params;
+    if (!Load(path_, params)) {
+        std::exit(EXIT_FAILURE); // Exit the program if critical parameters are invalid
+    }
+    Publish(params);
+}
+
+bool Config::Reload() {
+    ConfigParameters params;
+    if (!Load(path_, params)) {
+        return false;
+    }
+    Publish(params);
+    return true;
+}
+
+Config::Snapshot Config::Current() {
+    return current_.load(std::memory_order_acquire);
 }
 
 Config::ConfigParameters Config::GetConfigParameters() {
-    return config_parameters_;
+    return *Current();
 }
@@ -1,28 +1,123 @@
 #pragma once
 
+#include <atomic>
+#include <cstdint>
+#include <memory>
 #include <string>
 
 class Config {
 public:
 	struct ConfigParameters {
-		int num_cpu;
+		int num_cpu = 0;
 		std::string scheduler;
-		int quantum_cycles;
-		double batch_process_freq;
-		int min_ins;
-		int max_ins;
-		double delay_per_exec;
+		int quantum_cycles = 0;
+		// "fixed" keeps quantum_cycles; "adaptive" retunes the RR quantum
+		// between quantum_min_cycles and quantum_max_cycles to meet
+		// target_response_ms, moving only past quantum_hysteresis percent
+		std::string quantum_mode = "fixed";
+		int target_response_ms = 100;
+		int quantum_min_cycles = 1;
+		int quantum_max_cycles = 100;
+		int quantum_hysteresis = 25;
+		double batch_process_freq = 0;
+		int min_ins = 0;
+		int max_ins = 0;
+		double delay_per_exec = 0;
 
 		// New parameters for memory management
 		size_t max_overall_mem = 0;  // Maximum memory available (in KB)
 		size_t mem_per_frame = 0;    // Memory per frame (in KB)
 		size_t min_mem_per_proc = 0; // Minimum memory per process (in KB)
 		size_t max_mem_per_proc = 0; // Maximum memory per process (in KB)
+		size_t huge_page_size = 0;      // Second page size for large processes (in KB), 0 for none
+		size_t huge_page_threshold = 0; // Smallest process given huge pages (in KB), 0 for huge_page_size
+		int working_set_window = 0;     // Samples a touched page stays in the working set (0-8); 0 admits and evicts by declared size
+		int prefetch_pages = 0;         // Pages read ahead after sequential faults
+		int swapper_free_frames = 0;    // Free frames a background swapper keeps; 0 evicts on the faulting core, as does lockstep
 
+		std::string cpu_affinity = "none"; // Host pinning of emulated cores: none, compact or spread
+
+		// Scheduling domains: "none" shares one ready queue, "numa" gives each
+		// NUMA node of the affinity layout its own, a number N each N cores
+		std::string scheduler_domains = "none";
+		int balance_interval_ms = 10;  // Between balancer passes; a core that runs dry also asks for one
+		double balance_threshold = 2;  // Difference in processes per core a pass evens out
+
+		// CPU groups, "name[:weight[:quota]],...": a weight shares the CPU
+		// like cgroups' cpu.shares (default 1024), a quota caps a group at that
+		// percentage of one core per quota period like cpu.max
+		std::string cpu_groups = "default";
+		int cpu_quota_period_ms = 100;
+
+		// Soft core affinity: a core prefers a process that ran on it within
+		// the last affinity_window_ms, and a process that moves to another
+		// core stalls migration_penalty_cycles first. Both are off at 0
+		int affinity_window_ms = 0;
+		int migration_penalty_cycles = 0;
+
+		// Arrivals of generated processes at 1 / batch_process_freq per second:
+		// "constant", "poisson", or "on-off" bursts of Poisson arrivals with
+		// the same mean rate, spread over arrival_threads producers
+		std::string arrival_model = "constant";
+		int arrival_threads = 1;
+		int burst_on_ms = 100;
+		int burst_off_ms = 400;
+
+		// Prometheus metrics export; both are off by default
+		int metrics_port = 0;           // Serve on 127.0.0.1:<port> when non-zero
+		std::string metrics_file;       // Rewrite this file every metrics_interval seconds when set
+		double metrics_interval = 5;
+
+		int dispatch_batch = 1; // Processes a core takes from the ready queue per lock acquisition
+
+		// Global cycle clock. "free" lets cores run unsynchronized; "lockstep"
+		// advances them together through barrier phases for reproducible runs
+		std::string clock_mode = "free";
+		double clock_hz = 1000;        // Emulated cycles per second in lockstep
+		int clock_sync_ticks = 1;      // Cycles each core runs between barriers
+		std::string clock_pace = "realtime"; // "fast" runs phases back to back
+
+		// "threads" gives each emulated core its own host thread; "coroutines"
+		// multiplexes them onto host-threads pool threads (0: one per host CPU)
+		std::string core_runtime = "threads";
+		int host_threads = 0;
+
+		int sleep_tick_us = 1000; // Wall length of one SLEEP tick; in lockstep a tick is a cycle
 	};
-	static void Initialize();
+
+	// Immutable, reference-counted view of the parameters. Stays valid for as
+	// long as it is held, even if a newer snapshot is published meanwhile.
+	using Snapshot = std::shared_ptr<const ConfigParameters>;
+
+	// Per-thread cached snapshot for hot loops. get() costs one atomic load of
+	// the generation counter and only touches the shared snapshot when it changed.
+	class Reader {
+	public:
+		const ConfigParameters& get() {
+			uint64_t generation = generation_.load(std::memory_order_acquire);
+			if (generation != seen_generation) {
+				snapshot = Current();
+				seen_generation = generation;
+			}
+			return *snapshot;
+		}
+
+	private:
+		Snapshot snapshot;
+		uint64_t seen_generation = ~0ULL;
+	};
+
+	static void Initialize(const std::string& path = "config.txt");
+	static bool Reload(); // Re-reads the config file and publishes it; keeps the old snapshot on error
+	static Snapshot Current();
+	static uint64_t Generation() { return generation_.load(std::memory_order_acquire); }
 	static ConfigParameters GetConfigParameters();
 
 private:
-	static ConfigParameters config_parameters_;
-};
\ No newline at end of file
+	static bool Load(const std::string& path, ConfigParameters& params);
+	static void Publish(const ConfigParameters& params);
+
+	static std::string path_; // Control thread only
+	static std::atomic<Snapshot> current_;
+	static std::atomic<uint64_t> generation_;
+};
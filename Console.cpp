@@ -2,13 +2,13 @@
 #include <iostream>
 #include <ctime>
 #include <string>
+#include "Platform.h"
 
 // constructor
 Console::Console(std::string n, int cLine, int tLines, int id) : name(n), currentLine(cLine), totalLines(tLines), processId(id) {
 	// Get current timestamp
 	std::time_t now = std::time(nullptr);
-	struct tm timeInfo;
-	localtime_s(&timeInfo, &now);
+	struct tm timeInfo = toLocalTime(now);
 	char timeStr[64];
 	std::strftime(timeStr, sizeof(timeStr), "%m/%d/%Y, %I:%M:%S %p", &timeInfo);
 	timestamp = timeStr;
@@ -19,7 +19,7 @@ std::string Console::getName() const {
 }
 
 void Console::drawProcess() {
-	system("cls");
+	clearConsole();
 	std::cout << "Process: " << name << std::endl;
 	std::cout << "ID: " << processId << std::endl;
 	std::cout << "Current instruction line: " << currentLine << std::endl;
@@ -3,10 +3,10 @@
 #include "Config.h"
 #include "Commands.h"
 #include <iostream>
-#include "Process.h";
+#include "Process.h"
+#include "Platform.h"
 #include <string>
 #include <vector>
-#include <conio.h>
 #include <random>
 
 std::shared_ptr<Console> ConsoleManager::currentConsole = nullptr;
@@ -64,7 +64,7 @@ bool ConsoleManager::handleCommand(const std::string& command) {
 
     // Current console is not the main menu and the exit command is entered.
     if (command == "exit" && (getCurrentConsoleName() != "MAIN_MENU")) {
-        system("cls");
+        clearConsole();
         // Find the console with the name "MAIN_MENU"
         for (const auto& consolePtr : consoles) {
             if (consolePtr->getName() == "MAIN_MENU") {
@@ -3,7 +3,6 @@
 #include <string>
 #include <vector>
 #include <memory>
-#include <windows.h>
 
 class ConsoleManager {
 private:
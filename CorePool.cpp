@@ -0,0 +1,100 @@
+#include "CorePool.h"
+#include <algorithm>
+
+void CoreTask::promise_type::FinalAwaiter::await_suspend(std::coroutine_handle<promise_type> handle) noexcept {
+    CorePool* pool = handle.promise().pool;
+    handle.destroy();
+    pool->taskFinished();
+}
+
+CorePool::CorePool(int count) {
+    if (count <= 0) {
+        count = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    }
+    for (int i = 0; i < count; ++i) {
+        threads.emplace_back(&CorePool::run, this);
+    }
+}
+
+CorePool::~CorePool() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stopping = true;
+    }
+    cv.notify_all();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+void CorePool::spawn(CoreTask task) {
+    std::coroutine_handle<CoreTask::promise_type> handle = task.handle;
+    task.handle = nullptr;
+    handle.promise().pool = this;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        ++live_tasks;
+        ready.push_back(handle);
+    }
+    cv.notify_one();
+}
+
+void CorePool::post(std::coroutine_handle<> handle) {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        ready.push_back(handle);
+    }
+    cv.notify_one();
+}
+
+void CorePool::postAt(std::chrono::steady_clock::time_point when, std::coroutine_handle<> handle) {
+    bool earliest;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        earliest = timers.empty() || when < timers.top().when;
+        timers.push({ when, timer_sequence++, handle });
+    }
+    // Only a new earliest deadline changes how long an idle thread should wait
+    if (earliest) {
+        cv.notify_one();
+    }
+}
+
+void CorePool::taskFinished() {
+    std::lock_guard<std::mutex> lock(mtx);
+    if (--live_tasks == 0) {
+        done_cv.notify_all();
+    }
+}
+
+void CorePool::join() {
+    std::unique_lock<std::mutex> lock(mtx);
+    done_cv.wait(lock, [&] { return live_tasks == 0; });
+}
+
+void CorePool::run() {
+    std::unique_lock<std::mutex> lock(mtx);
+    while (!stopping) {
+        auto now = std::chrono::steady_clock::now();
+        while (!timers.empty() && timers.top().when <= now) {
+            ready.push_back(timers.top().handle);
+            timers.pop();
+        }
+
+        if (!ready.empty()) {
+            std::coroutine_handle<> handle = ready.front();
+            ready.pop_front();
+            lock.unlock();
+            handle.resume();
+            lock.lock();
+            continue;
+        }
+
+        if (timers.empty()) {
+            cv.wait(lock);
+        }
+        else {
+            cv.wait_until(lock, timers.top().when);
+        }
+    }
+}
@@ -0,0 +1,116 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+class CorePool;
+
+// Coroutine body of one emulated core. Starts suspended; CorePool::spawn
+// hands it to the pool, which owns the frame from then on.
+class CoreTask {
+public:
+    struct promise_type {
+        CorePool* pool = nullptr;
+
+        struct FinalAwaiter {
+            bool await_ready() noexcept { return false; }
+            void await_suspend(std::coroutine_handle<promise_type> handle) noexcept;
+            void await_resume() noexcept {}
+        };
+
+        CoreTask get_return_object() { return CoreTask(std::coroutine_handle<promise_type>::from_promise(*this)); }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        FinalAwaiter final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+
+    CoreTask(CoreTask&& other) noexcept : handle(other.handle) { other.handle = nullptr; }
+    CoreTask(const CoreTask&) = delete;
+    CoreTask& operator=(const CoreTask&) = delete;
+    ~CoreTask() {
+        if (handle) handle.destroy(); // Never spawned
+    }
+
+private:
+    friend class CorePool;
+    explicit CoreTask(std::coroutine_handle<promise_type> handle) : handle(handle) {}
+    std::coroutine_handle<promise_type> handle;
+};
+
+// Small pool of host threads that runs emulated cores as coroutines, so the
+// emulated core count is not bound by how many kernel threads the host can
+// afford. A core gives up its host thread whenever it suspends: on a timer
+// (sleepFor), to let other cores run (yield), or on a scheduler-defined
+// awaiter that parks it until work arrives. Timers are kept in a min-heap
+// and fired by whichever pool thread is idle when they come due.
+class CorePool {
+public:
+    // 0 sizes the pool to the host's hardware threads
+    explicit CorePool(int threads);
+    ~CorePool();
+    CorePool(const CorePool&) = delete;
+    CorePool& operator=(const CorePool&) = delete;
+
+    // Starts running `task` on the pool.
+    void spawn(CoreTask task);
+    // Queues a suspended coroutine to be resumed on a pool thread.
+    void post(std::coroutine_handle<> handle);
+    // Blocks until every spawned task has returned.
+    void join();
+
+    int threadCount() const { return static_cast<int>(threads.size()); }
+
+    // How long a core may run without suspending before it should yield its host thread
+    static constexpr std::chrono::microseconds TIME_SLICE{ 1000 };
+
+    struct SleepAwaiter {
+        CorePool& pool;
+        std::chrono::steady_clock::time_point until;
+        bool await_ready() const { return until <= std::chrono::steady_clock::now(); }
+        void await_suspend(std::coroutine_handle<> handle) { pool.postAt(until, handle); }
+        void await_resume() const {}
+    };
+    struct YieldAwaiter {
+        CorePool& pool;
+        bool await_ready() const { return false; }
+        void await_suspend(std::coroutine_handle<> handle) { pool.post(handle); }
+        void await_resume() const {}
+    };
+
+    SleepAwaiter sleepFor(std::chrono::steady_clock::duration duration) { return { *this, std::chrono::steady_clock::now() + duration }; }
+    // Goes to the back of the ready queue behind every other runnable core
+    YieldAwaiter yield() { return { *this }; }
+
+private:
+    friend struct CoreTask::promise_type::FinalAwaiter; // Calls taskFinished
+
+    struct Timer {
+        std::chrono::steady_clock::time_point when;
+        uint64_t sequence; // Keeps timers with equal deadlines in FIFO order
+        std::coroutine_handle<> handle;
+        bool operator>(const Timer& other) const {
+            return when != other.when ? when > other.when : sequence > other.sequence;
+        }
+    };
+
+    void postAt(std::chrono::steady_clock::time_point when, std::coroutine_handle<> handle);
+    void taskFinished();
+    void run();
+
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::condition_variable done_cv;
+    std::deque<std::coroutine_handle<>> ready;
+    std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer>> timers;
+    uint64_t timer_sequence = 0;
+    size_t live_tasks = 0;
+    bool stopping = false;
+    std::vector<std::thread> threads;
+};
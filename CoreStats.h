@@ -0,0 +1,17 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+// Per emulated core data. Each worker allocates its own after pinning so the
+// memory is first touched, and therefore placed, on that core's NUMA node.
+// Cache-line aligned so cores never share a line.
+struct alignas(64) CoreStats {
+    int host_cpu = -1;   // Pinned host CPU, -1 when unpinned
+    int numa_node = -1;  // NUMA node of host_cpu
+    std::atomic<uint64_t> dispatches{ 0 };   // Processes dispatched on this core
+    std::atomic<uint64_t> busy_cycles{ 0 };  // Cycles spent executing process code
+    std::atomic<uint64_t> busy_nanoseconds{ 0 }; // Wall time between dispatch and retire
+    std::atomic<uint64_t> migrations_in{ 0 };   // Dispatched here after last running on another core
+    std::atomic<uint64_t> home_dispatches{ 0 }; // Dispatched back here after last running here
+    std::atomic<uint64_t> stall_cycles{ 0 };    // Refilling the cache after a migration, see SoftAffinity
+};
@@ -0,0 +1,267 @@
+#include "CpuGroups.h"
+#include <algorithm>
+#include <sstream>
+#include "Metrics.h"
+#include "Process.h"
+#include "ReportRenderer.h"
+#include "SoftAffinity.h"
+
+namespace {
+
+// Shifts usage before dividing by the weight so small charges still count
+constexpr uint64_t VTIME_SCALE = 1u << 20;
+
+bool parseNumber(const std::string& text, uint32_t& number) {
+    if (text.empty() || text.size() > 9 || text.find_first_not_of("0123456789") != std::string::npos) return false;
+    number = static_cast<uint32_t>(std::stoul(text));
+    return true;
+}
+
+}
+
+bool CpuGroups::parse(const std::string& value, std::vector<Spec>& specs) {
+    specs.clear();
+    std::stringstream entries(value);
+    std::string entry;
+    while (std::getline(entries, entry, ',')) {
+        std::stringstream fields(entry);
+        std::string name, weight, quota;
+        std::getline(fields, name, ':');
+        std::getline(fields, weight, ':');
+        std::getline(fields, quota, ':');
+
+        Spec spec;
+        spec.name = name;
+        bool repeated = std::any_of(specs.begin(), specs.end(), [&](const Spec& other) { return other.name == name; });
+        if (name.empty() || repeated) return false;
+        if (!weight.empty() && (!parseNumber(weight, spec.weight) || spec.weight < 1 || spec.weight > MAX_WEIGHT)) return false;
+        if (!quota.empty() && !parseNumber(quota, spec.quota_percent)) return false;
+        if (!fields.eof() && fields.peek() != EOF) return false; // A fourth field
+        specs.push_back(spec);
+    }
+    return !specs.empty();
+}
+
+int CpuGroups::find(const std::vector<Spec>& specs, const std::string& name) {
+    for (size_t i = 0; i < specs.size(); ++i) {
+        if (specs[i].name == name) return static_cast<int>(i);
+    }
+    return 0;
+}
+
+CpuGroups::CpuGroups() {
+    configure({ Spec{ "default" } });
+}
+
+void CpuGroups::configure(const std::vector<Spec>& specs) {
+    groups.clear();
+    quotas = false;
+    for (const Spec& spec : specs) {
+        auto group = std::make_unique<Group>();
+        group->spec = spec;
+        group->max_cores = static_cast<int>((spec.quota_percent + 99) / 100);
+        quotas = quotas || spec.quota_percent > 0;
+        groups.push_back(std::move(group));
+    }
+    setPeriod(period, units_per_second);
+    floor.store(0, std::memory_order_relaxed);
+}
+
+void CpuGroups::setPeriod(uint64_t units, double per_second) {
+    period = std::max<uint64_t>(units, 1);
+    units_per_second = per_second;
+    for (const auto& group : groups) {
+        group->quota = group->spec.quota_percent == 0 ? 0 : std::max<uint64_t>(1, period * group->spec.quota_percent / 100);
+    }
+    period_end.store(0, std::memory_order_relaxed); // The next refill starts a period
+}
+
+void CpuGroups::charge(int index, uint64_t used) {
+    Group& group = at(index);
+    group.usage.fetch_add(used, std::memory_order_relaxed);
+
+    uint64_t vtime = group.vtime.load(std::memory_order_relaxed);
+    uint64_t lowest = floor.load(std::memory_order_relaxed);
+    if (vtime < lowest) {
+        group.vtime.compare_exchange_strong(vtime, lowest, std::memory_order_relaxed); // Another core may have charged it meanwhile
+    }
+    group.vtime.fetch_add(used * VTIME_SCALE / group.spec.weight, std::memory_order_relaxed);
+
+    if (group.quota != 0 && group.period_used.fetch_add(used, std::memory_order_relaxed) + used >= group.quota) {
+        if (!group.throttled.exchange(true, std::memory_order_relaxed)) {
+            group.throttles.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+}
+
+bool CpuGroups::eligible(int index) const {
+    const Group& group = at(index);
+    return !group.throttled.load(std::memory_order_relaxed)
+        && (group.max_cores == 0 || group.on_cores.load(std::memory_order_relaxed) < group.max_cores);
+}
+
+uint64_t CpuGroups::virtualTime(int group) const {
+    return std::max(at(group).vtime.load(std::memory_order_relaxed), floor.load(std::memory_order_relaxed));
+}
+
+void CpuGroups::advanceFloor(uint64_t vtime) {
+    uint64_t lowest = floor.load(std::memory_order_relaxed);
+    while (lowest < vtime && !floor.compare_exchange_weak(lowest, vtime, std::memory_order_relaxed)) {
+    }
+}
+
+bool CpuGroups::refill(uint64_t now) {
+    if (!quotas || now < period_end.load(std::memory_order_relaxed)) return false;
+    std::lock_guard<std::mutex> lock(period_mtx);
+    if (now < period_end.load(std::memory_order_relaxed)) return false;
+
+    period_end.store(now + period, std::memory_order_relaxed);
+    bool released = false;
+    for (const auto& group : groups) {
+        group->period_used.store(0, std::memory_order_relaxed);
+        released = group->throttled.exchange(false, std::memory_order_relaxed) || released;
+    }
+    return released;
+}
+
+double CpuGroups::usageSeconds(int group) const {
+    return static_cast<double>(at(group).usage.load(std::memory_order_relaxed)) / units_per_second;
+}
+
+void CpuGroups::collectMetrics(MetricsWriter& out) const {
+    out.family("csopesy_cpu_group_usage_seconds_total", "counter", "CPU time charged to each CPU group.");
+    for (size_t i = 0; i < groups.size(); ++i) {
+        out.sample("csopesy_cpu_group_usage_seconds_total", "group", groups[i]->spec.name.c_str(), usageSeconds(static_cast<int>(i)));
+    }
+    out.family("csopesy_cpu_group_throttled_periods_total", "counter", "Quota periods in which each CPU group ran out of quota.");
+    for (const auto& group : groups) {
+        out.sample("csopesy_cpu_group_throttled_periods_total", "group", group->spec.name.c_str(), static_cast<double>(group->throttles.load(std::memory_order_relaxed)));
+    }
+    out.family("csopesy_cpu_group_throttled", "gauge", "1 while a CPU group waits for its next quota period.");
+    for (const auto& group : groups) {
+        out.sample("csopesy_cpu_group_throttled", "group", group->spec.name.c_str(), group->throttled.load(std::memory_order_relaxed) ? 1.0 : 0.0);
+    }
+}
+
+void CpuGroups::appendSummary(ReportRenderer& report, const std::vector<size_t>& queued) const {
+    double total = 0;
+    for (size_t i = 0; i < groups.size(); ++i) {
+        total += usageSeconds(static_cast<int>(i));
+    }
+    report.append("CPU groups: ");
+    report.appendNumber(static_cast<long long>(groups.size()));
+    if (quotas) {
+        report.append(", quota period ");
+        report.appendNumber(static_cast<long long>(static_cast<double>(period) * 1000 / units_per_second));
+        report.append(" ms");
+    }
+    report.append("\n");
+    for (size_t i = 0; i < groups.size(); ++i) {
+        const Group& group = *groups[i];
+        double seconds = usageSeconds(static_cast<int>(i));
+        report.append("  ");
+        report.append(group.spec.name);
+        report.append(": weight ");
+        report.appendNumber(group.spec.weight);
+        if (group.spec.quota_percent != 0) {
+            report.append(", quota ");
+            report.appendNumber(group.spec.quota_percent);
+            report.append("%");
+        }
+        report.append(", usage ");
+        report.appendFixed(seconds, 2, 0);
+        report.append(" s (");
+        report.appendFixed(total > 0 ? seconds * 100 / total : 0, 1, 0);
+        report.append("%), ");
+        report.appendNumber(static_cast<long long>(i < queued.size() ? queued[i] : 0));
+        report.append(" ready");
+        if (group.spec.quota_percent != 0) {
+            report.append(", throttled ");
+            report.appendNumber(static_cast<long long>(group.throttles.load(std::memory_order_relaxed)));
+            report.append(group.throttled.load(std::memory_order_relaxed) ? " periods, out of quota" : " periods");
+        }
+        report.append("\n");
+    }
+}
+
+void GroupQueue::push(Process* proc) {
+    queueOf(proc).push_back(proc);
+    ++count;
+}
+
+void GroupQueue::pushFront(Process* proc) {
+    queueOf(proc).push_front(proc);
+    ++count;
+}
+
+std::deque<Process*>& GroupQueue::queueOf(Process* proc) {
+    size_t group = static_cast<size_t>(std::max(proc->group, 0));
+    if (group >= queues.size()) {
+        queues.resize(group + 1);
+    }
+    return queues[group];
+}
+
+int GroupQueue::pick(const CpuGroups& groups) const {
+    if (queues.size() == 1) {
+        return queues[0].empty() || !groups.eligible(0) ? -1 : 0; // The common case needs no virtual time
+    }
+    int best = -1;
+    uint64_t best_vtime = 0;
+    for (size_t i = 0; i < queues.size(); ++i) {
+        int group = static_cast<int>(i);
+        if (queues[i].empty() || !groups.eligible(group)) continue;
+        uint64_t vtime = groups.virtualTime(group);
+        if (best < 0 || vtime < best_vtime) {
+            best = group;
+            best_vtime = vtime;
+        }
+    }
+    return best;
+}
+
+Process* GroupQueue::peek(const CpuGroups& groups) const {
+    int group = pick(groups);
+    return group < 0 ? nullptr : queues[group].front();
+}
+
+Process* GroupQueue::pop(CpuGroups& groups) {
+    int group = pick(groups);
+    return group < 0 ? nullptr : take(groups, group, 0);
+}
+
+Process* GroupQueue::pop(CpuGroups& groups, const SoftAffinity& affinity, int core, uint64_t now) {
+    int group = pick(groups);
+    return group < 0 ? nullptr : take(groups, group, affinity.choose(queues[group], core, now));
+}
+
+Process* GroupQueue::take(CpuGroups& groups, int group, size_t index) {
+    if (queues.size() > 1) {
+        groups.advanceFloor(groups.virtualTime(group));
+    }
+    groups.enter(group);
+    auto& queue = queues[group];
+    Process* proc = queue[index];
+    queue.erase(queue.begin() + static_cast<std::ptrdiff_t>(index));
+    --count;
+    return proc;
+}
+
+Process* GroupQueue::popBack() {
+    std::deque<Process*>* longest = nullptr;
+    for (auto& queue : queues) {
+        if (!queue.empty() && (!longest || queue.size() > longest->size())) {
+            longest = &queue;
+        }
+    }
+    if (!longest) return nullptr;
+    Process* proc = longest->back();
+    longest->pop_back();
+    --count;
+    return proc;
+}
+
+void GroupQueue::clear() {
+    queues.clear();
+    count = 0;
+}
@@ -0,0 +1,153 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class Process;
+class MetricsWriter;
+class ReportRenderer;
+class SoftAffinity;
+
+// Named CPU groups with a weight and an optional hard quota, after cgroups'
+// cpu.shares and cpu.max. Every process belongs to one group (Process::group)
+// and CPU time is charged to it as its cores use it. Among the groups with a
+// ready process, the next core goes to the one with the least virtual time:
+// its usage scaled by DEFAULT_WEIGHT / weight, so under contention groups get
+// CPU in proportion to their weights however many processes each submits.
+// A group with a quota may use `quota_percent` of one core per period (200 is
+// two cores); once it has, its processes stay queued until the period ends.
+// It also runs on no more cores at a time than its quota covers, rounded up,
+// so a period's refill does not send every core to it at once: a core only
+// notices the quota ran out at the end of an interpreter step.
+//
+// Usage is counted in the scheduler's time units: nanoseconds when cores run
+// free, cycles in lockstep. Charging and the per-group state are lock-free,
+// so cores of different domains charge without sharing a lock.
+class CpuGroups {
+public:
+    static constexpr uint32_t DEFAULT_WEIGHT = 1024;
+    static constexpr uint32_t MAX_WEIGHT = 262144;
+
+    struct Spec {
+        std::string name;
+        uint32_t weight = DEFAULT_WEIGHT;
+        uint32_t quota_percent = 0;    // Of one core per period; 0 for none
+    };
+    // "name[:weight[:quota]],..." such as "web:2048,batch:512:50". False if
+    // an entry is malformed or a name repeats.
+    static bool parse(const std::string& value, std::vector<Spec>& specs);
+    // Index of the group called `name`, or 0
+    static int find(const std::vector<Spec>& specs, const std::string& name);
+
+    CpuGroups(); // A single group, "default", without a quota
+
+    // Replaces the groups, dropping their usage. Before the cores start.
+    void configure(const std::vector<Spec>& specs);
+    // Quota period in usage units, and how many units make a second (for reports)
+    void setPeriod(uint64_t period, double units_per_second);
+
+    size_t size() const { return groups.size(); }
+    const Spec& spec(int group) const { return at(group).spec; }
+    bool hasQuota() const { return quotas; }
+
+    // Adds `used` units to a group's usage and virtual time, and throttles it
+    // once it has spent its quota for this period.
+    void charge(int group, uint64_t used);
+    bool throttled(int group) const { return at(group).throttled.load(std::memory_order_relaxed); }
+    // Not throttled and below its core limit
+    bool eligible(int group) const;
+    // A process of the group was taken for a core, and came off it or went back to a queue
+    void enter(int group) { at(group).on_cores.fetch_add(1, std::memory_order_relaxed); }
+    void leave(int group) { at(group).on_cores.fetch_sub(1, std::memory_order_relaxed); }
+    // Virtual time, never behind the floor: a group that was idle competes
+    // from where the others are instead of catching up on the time it missed.
+    uint64_t virtualTime(int group) const;
+    // Called with the chosen group's virtual time on every pick
+    void advanceFloor(uint64_t vtime);
+
+    // Starts a new quota period once `now` reaches the end of the current
+    // one. True if that released a throttled group, so idle cores should look
+    // at their queues again.
+    bool refill(uint64_t now);
+    uint64_t periodEnd() const { return period_end.load(std::memory_order_relaxed); }
+
+    // Per-group usage, throttling and weights; reads only atomics
+    void collectMetrics(MetricsWriter& out) const;
+    // One line per group; `queued` holds the ready processes of each group
+    void appendSummary(ReportRenderer& report, const std::vector<size_t>& queued) const;
+    double usageSeconds(int group) const;
+
+private:
+    struct Group {
+        Spec spec;
+        uint64_t quota = 0;                  // Units per period; 0 for none
+        int max_cores = 0;                   // 0 for no limit
+        std::atomic<int> on_cores{ 0 };      // Taken by pop and not yet given back
+        std::atomic<uint64_t> usage{ 0 };
+        std::atomic<uint64_t> vtime{ 0 };
+        std::atomic<uint64_t> period_used{ 0 };
+        std::atomic<bool> throttled{ false };
+        std::atomic<uint64_t> throttles{ 0 }; // Periods in which the quota ran out
+    };
+    // Out-of-range indices (a process from a differently configured run) fall into group 0
+    const Group& at(int group) const { return *groups[group >= 0 && static_cast<size_t>(group) < groups.size() ? group : 0]; }
+    Group& at(int group) { return *groups[group >= 0 && static_cast<size_t>(group) < groups.size() ? group : 0]; }
+
+    std::vector<std::unique_ptr<Group>> groups;
+    bool quotas = false;
+    uint64_t period = 100000000;          // 100 ms in nanoseconds
+    double units_per_second = 1e9;
+    std::atomic<uint64_t> period_end{ 0 };
+    std::atomic<uint64_t> floor{ 0 };
+    std::mutex period_mtx;                // Only the thread starting a new period takes it
+};
+
+// A ready queue of per-group FIFO queues: the group level picks by virtual
+// time and quota through CpuGroups, the processes of a group take turns in
+// arrival order. With a single group it is a plain FIFO queue.
+//
+// Not synchronized; its scheduling domain's lock guards it.
+class GroupQueue {
+public:
+    void push(Process* proc);      // At the tail of its group
+    void pushFront(Process* proc); // At the head of its group
+
+    // Head of the group next in line, or nullptr if no group with queued
+    // processes is eligible. pop also removes it, advances the floor and
+    // enters its group; the caller leaves the group once the process is off
+    // the core again, whether it retires, blocks or is queued once more.
+    Process* peek(const CpuGroups& groups) const;
+    Process* pop(CpuGroups& groups);
+    // pop, but within the group takes the process SoftAffinity::choose
+    // prefers for `core` instead of the head
+    Process* pop(CpuGroups& groups, const SoftAffinity& affinity, int core, uint64_t now);
+    // Tail of the group with the most queued processes, lowest index on ties;
+    // what the balancer moves.
+    Process* popBack();
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    bool runnable(const CpuGroups& groups) const { return pick(groups) >= 0; }
+    void clear();
+
+    // Group by group, each in queue order
+    template <typename Visit>
+    void forEach(Visit visit) const {
+        for (const auto& queue : queues) {
+            for (Process* proc : queue) visit(proc);
+        }
+    }
+
+private:
+    int pick(const CpuGroups& groups) const; // Queue index, or -1
+    std::deque<Process*>& queueOf(Process* proc);
+    Process* take(CpuGroups& groups, int group, size_t index); // What pop does once it has picked
+
+    std::vector<std::deque<Process*>> queues; // Indexed by group, grown on demand
+    size_t count = 0;
+};
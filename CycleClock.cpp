@@ -0,0 +1,40 @@
+#include "CycleClock.h"
+#include <algorithm>
+#include <thread>
+
+CycleClock::CycleClock(int cores, const Settings& settings, uint64_t first_cycle, Step step)
+    : step(std::move(step)),
+    ticks_per_sync(std::max<uint64_t>(1, settings.ticks_per_sync)),
+    phase_length(settings.fast || settings.hz <= 0
+        ? std::chrono::steady_clock::duration::zero()
+        : std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(ticks_per_sync / settings.hz))),
+    cycle(first_cycle),
+    barrier(std::max(cores, 1), Completion{ this }) {}
+
+bool CycleClock::sync() {
+    barrier.arrive_and_wait();
+    return ticking.load(std::memory_order_acquire);
+}
+
+void CycleClock::complete() noexcept {
+    if (!ticking.load(std::memory_order_relaxed)) return;
+
+    if (!started) {
+        // Cores have only just arrived; nothing ran yet
+        started = true;
+        next_phase = std::chrono::steady_clock::now();
+    }
+    else {
+        cycle.fetch_add(ticks_per_sync, std::memory_order_release);
+    }
+
+    if (!step(cycle.load(std::memory_order_relaxed))) {
+        ticking.store(false, std::memory_order_release);
+        return;
+    }
+
+    if (phase_length != std::chrono::steady_clock::duration::zero()) {
+        next_phase += phase_length;
+        std::this_thread::sleep_until(next_phase);
+    }
+}
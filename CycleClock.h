@@ -0,0 +1,66 @@
+#pragma once
+#include <atomic>
+#include <barrier>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+
+// Global cycle counter that keeps every emulated core in lockstep. Cores run
+// in phases of `ticks_per_sync` cycles and meet at a std::barrier after each
+// phase; the barrier's completion step advances the counter and runs the
+// scheduler's step function single-threaded before releasing the next phase.
+// Because every scheduling decision happens in that step, in core order, the
+// interleaving of processes on cores only depends on the cycle count and is
+// identical from run to run. Phases are paced at `hz` cycles per second, or
+// run back to back when `fast` is set.
+class CycleClock {
+public:
+    struct Settings {
+        bool lockstep = false;        // Free-running cores when false
+        uint64_t ticks_per_sync = 1;  // Cycles per barrier phase
+        double hz = 1000;             // Emulated cycles per second
+        bool fast = false;            // Ignore hz and run as fast as the host allows
+    };
+
+    // Returns false to stop the clock. Runs while every core waits at the barrier.
+    using Step = std::function<bool(uint64_t cycle)>;
+
+    // Counts from `first_cycle`, so a restarted scheduler keeps its cycle numbers
+    CycleClock(int cores, const Settings& settings, uint64_t first_cycle, Step step);
+
+    // Called by each core once per phase. Returns false once the clock has
+    // stopped; every core sees the same answer for the same phase.
+    bool sync();
+
+    // Folds one dispatch into a running FNV-1a hash of the schedule. Two runs
+    // made the same decisions iff they end with the same hash (barring collisions).
+    static constexpr uint64_t HASH_SEED = 14695981039346656037ULL;
+    static uint64_t hashDispatch(uint64_t hash, uint64_t cycle, int core_id, int process_id) {
+        for (uint64_t value : { cycle, static_cast<uint64_t>(core_id), static_cast<uint64_t>(process_id) }) {
+            hash = (hash ^ value) * 1099511628211ULL;
+        }
+        return hash;
+    }
+
+    uint64_t now() const { return cycle.load(std::memory_order_acquire); }
+    uint64_t ticksPerSync() const { return ticks_per_sync; }
+    bool stopped() const { return !ticking.load(std::memory_order_acquire); }
+
+private:
+    void complete() noexcept;
+
+    struct Completion {
+        CycleClock* clock;
+        void operator()() noexcept { clock->complete(); }
+    };
+
+    Step step;
+    const uint64_t ticks_per_sync;
+    const std::chrono::steady_clock::duration phase_length; // Zero in fast mode
+    std::chrono::steady_clock::time_point next_phase;
+    bool started = false;             // First completion only releases the cores
+    std::atomic<uint64_t> cycle{ 0 };
+    std::atomic<bool> ticking{ true }; // Written by the completion step only
+    std::barrier<Completion> barrier;
+};
@@ -0,0 +1,229 @@
+#include "Dashboard.h"
+#include "Platform.h"
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
+#include <ctime>
+#include <iostream>
+
+namespace {
+
+constexpr int HEADER_ROWS = 6;  // Summary lines, a blank line and the column header
+constexpr int CELL_WIDTH = 46;  // "CORE  CPU  UTIL PROCESS          PROGRESS" plus a gap
+constexpr int RUN_GAP = 8;      // Unchanged cells worth rewriting rather than repositioning
+
+}
+
+Dashboard::Dashboard(Source source) : source(std::move(source)) {}
+
+Dashboard::~Dashboard() {
+    stop();
+}
+
+bool Dashboard::start(std::chrono::milliseconds interval) {
+    if (running || !enableAnsiTerminal()) return false;
+    running = true;
+    shown.clear();
+    primed = false;
+    last_frame = std::chrono::steady_clock::now();
+
+    std::cout << "\033[?1049h\033[?25l" << std::flush; // Alternate screen, hide cursor
+    thread = std::thread(&Dashboard::loop, this, interval);
+    return true;
+}
+
+void Dashboard::stop() {
+    {
+        std::lock_guard<std::mutex> lock(wake_mtx);
+        if (!running) return;
+        running = false;
+    }
+    wake.notify_all();
+    if (thread.joinable()) {
+        thread.join();
+    }
+    std::cout << "\033[?25h\033[?1049l" << std::flush; // Show cursor, back to the prompt
+}
+
+void Dashboard::loop(std::chrono::milliseconds interval) {
+    auto next = std::chrono::steady_clock::now();
+    while (running) {
+        auto now = std::chrono::steady_clock::now();
+        double elapsed = std::chrono::duration<double>(now - last_frame).count();
+        last_frame = now;
+
+        source(view);
+        compose(elapsed);
+        flush();
+
+        next += interval;
+        std::unique_lock<std::mutex> lock(wake_mtx);
+        wake.wait_until(lock, next, [&] { return !running; });
+    }
+}
+
+void Dashboard::put(int row, int col, std::string_view text) {
+    if (row < 0 || row >= static_cast<int>(frame.size()) || col >= width) return;
+    size_t length = std::min(text.size(), static_cast<size_t>(width - col));
+    frame[row].replace(col, length, text.data(), length);
+}
+
+void Dashboard::putNumber(int row, int col, long long value, int field) {
+    char digits[24];
+    auto result = std::to_chars(digits, digits + sizeof(digits), value);
+    int length = static_cast<int>(result.ptr - digits);
+    put(row, col + std::max(0, field - length), std::string_view(digits, length));
+}
+
+void Dashboard::compose(double elapsed_seconds) {
+    int columns, rows;
+    terminalSize(columns, rows);
+    width = std::max(columns, 1);
+    height = std::max(rows - 1, 1); // Leave the last line alone so the terminal never scrolls
+
+    frame.resize(height);
+    for (auto& line : frame) {
+        line.assign(width, ' ');
+    }
+
+    // Rates since the previous frame; the first frame (or a change in core
+    // count) only records the baseline
+    size_t core_count = view.cores.size();
+    if (!primed || last_busy.size() != core_count) {
+        primed = true;
+        last_busy.resize(core_count);
+        for (size_t i = 0; i < core_count; ++i) {
+            last_busy[i] = view.cores[i].busy_nanoseconds;
+        }
+        last_instructions = view.instructions;
+        elapsed_seconds = 0;
+    }
+    uint64_t instructions_delta = view.instructions - std::min(last_instructions, view.instructions);
+    last_instructions = view.instructions;
+
+    char clock[16];
+    std::tm local_tm = toLocalTime(std::time(nullptr));
+    size_t clock_length = std::strftime(clock, sizeof(clock), "%H:%M:%S", &local_tm);
+
+    put(0, 0, "csopesy top - ");
+    put(0, 14, std::string_view(clock, clock_length));
+    put(0, 25, "scheduler: ");
+    put(0, 36, view.scheduler.empty() ? "-" : view.scheduler);
+    put(0, 44, "cores:");
+    putNumber(0, 50, static_cast<long long>(core_count), 5);
+    put(0, 58, "(Enter to exit)");
+
+    put(1, 0, "Processes:        running,        ready,        blocked,        finished");
+    putNumber(1, 11, static_cast<long long>(view.running), 6);
+    putNumber(1, 27, static_cast<long long>(view.ready), 6);
+    putNumber(1, 41, static_cast<long long>(view.blocked), 6);
+    putNumber(1, 57, static_cast<long long>(view.finished), 6);
+
+    put(2, 0, "Memory:             /             KB used  waiting:        page faults:");
+    putNumber(2, 8, static_cast<long long>(view.memory_used), 11);
+    putNumber(2, 22, static_cast<long long>(view.memory_total), 11);
+    putNumber(2, 51, static_cast<long long>(view.backlog), 6);
+    putNumber(2, 71, static_cast<long long>(view.page_faults), 9);
+
+    double busy_total = 0;
+    for (size_t i = 0; i < core_count; ++i) {
+        uint64_t busy = view.cores[i].busy_nanoseconds;
+        busy_total += static_cast<double>(busy - std::min(last_busy[i], busy));
+    }
+    int average = (core_count > 0 && elapsed_seconds > 0)
+        ? static_cast<int>(std::min(busy_total / 1e9 / elapsed_seconds / core_count, 1.0) * 100) : 0;
+    put(3, 0, "CPU:    % average    instructions/s:");
+    putNumber(3, 4, average, 4);
+    putNumber(3, 36, static_cast<long long>(elapsed_seconds > 0 ? instructions_delta / elapsed_seconds : 0), 12);
+
+    // Core cells, laid out in as many columns as the terminal fits
+    int cell_columns = std::max(1, width / CELL_WIDTH);
+    int cell_rows = std::max(1, height - HEADER_ROWS);
+    for (int c = 0; c < cell_columns && c * CELL_WIDTH < width; ++c) {
+        put(HEADER_ROWS - 1, c * CELL_WIDTH, "CORE  CPU UTIL PROCESS          PROGRESS");
+    }
+
+    size_t visible = std::min(core_count, static_cast<size_t>(cell_columns) * cell_rows);
+    if (visible < core_count) {
+        --visible; // Last cell reports the overflow
+    }
+    for (size_t i = 0; i < core_count; ++i) {
+        const DashboardView::Core& core = view.cores[i];
+        uint64_t busy = core.busy_nanoseconds - std::min(last_busy[i], core.busy_nanoseconds);
+        last_busy[i] = core.busy_nanoseconds;
+        if (i >= visible) continue;
+
+        int row = HEADER_ROWS + static_cast<int>(i % cell_rows);
+        int col = static_cast<int>(i / cell_rows) * CELL_WIDTH;
+        putNumber(row, col, static_cast<long long>(i), 4);
+        if (core.host_cpu >= 0) {
+            putNumber(row, col + 5, core.host_cpu, 4);
+        }
+        else {
+            put(row, col + 8, "-");
+        }
+        int util = elapsed_seconds > 0 ? static_cast<int>(std::min(busy / 1e9 / elapsed_seconds, 1.0) * 100) : 0;
+        putNumber(row, col + 9, util, 4);
+        put(row, col + 13, "%");
+        if (core.process.empty()) {
+            put(row, col + 15, "idle");
+            continue;
+        }
+        put(row, col + 15, std::string_view(core.process).substr(0, 16));
+        putNumber(row, col + 32, core.executed, 6);
+        put(row, col + 38, "/");
+        putNumber(row, col + 39, core.total, 6);
+    }
+    if (visible < core_count) {
+        int row = HEADER_ROWS + static_cast<int>(visible % cell_rows);
+        int col = static_cast<int>(visible / cell_rows) * CELL_WIDTH;
+        put(row, col, "  +");
+        putNumber(row, col + 3, static_cast<long long>(core_count - visible), 6);
+        put(row, col + 10, "more cores");
+    }
+}
+
+void Dashboard::flush() {
+    out.clear();
+
+    // First frame or a resize: start from a blank screen
+    if (shown.size() != frame.size() || shown.empty() || shown[0].size() != frame[0].size()) {
+        out.append("\033[2J");
+        shown.assign(frame.size(), std::string(frame.empty() ? 0 : frame[0].size(), ' '));
+    }
+
+    char position[32];
+    for (size_t row = 0; row < frame.size(); ++row) {
+        const std::string& before = shown[row];
+        const std::string& after = frame[row];
+        size_t col = 0;
+        while (col < after.size()) {
+            if (before[col] == after[col]) {
+                ++col;
+                continue;
+            }
+            // Extend the run across short stretches of unchanged cells: rewriting
+            // them is cheaper than another cursor move.
+            size_t begin = col, end = col + 1, same = 0;
+            for (size_t next = col + 1; next < after.size() && same < RUN_GAP; ++next) {
+                if (before[next] != after[next]) {
+                    end = next + 1;
+                    same = 0;
+                }
+                else {
+                    ++same;
+                }
+            }
+            int length = std::snprintf(position, sizeof(position), "\033[%zu;%zuH", row + 1, begin + 1);
+            out.append(position, length);
+            out.append(after, begin, end - begin);
+            col = end;
+        }
+    }
+
+    std::swap(shown, frame);
+    if (!out.empty()) {
+        std::cout.write(out.data(), static_cast<std::streamsize>(out.size()));
+        std::cout.flush();
+    }
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// State shown by one dashboard frame. Sources refill the same view every
+// frame, so strings and vectors keep their capacity.
+struct DashboardView {
+    struct Core {
+        int host_cpu = -1;
+        std::string process;         // Empty when the core is idle
+        int executed = 0;
+        int total = 0;
+        uint64_t busy_nanoseconds = 0; // Cumulative; the dashboard turns it into a rate
+    };
+
+    std::string scheduler;
+    std::vector<Core> cores;
+    size_t running = 0;
+    size_t ready = 0;
+    size_t backlog = 0;
+    size_t blocked = 0;
+    size_t finished = 0;
+    size_t memory_total = 0; // KB
+    size_t memory_used = 0;
+    size_t page_faults = 0;
+    uint64_t instructions = 0; // Cumulative instructions retired
+};
+
+// top-like live view of the emulator. Each frame is composed into a grid of
+// terminal cells and compared with the previous one; only the changed runs
+// are written, with cursor-positioning escapes, in a single write. A resize
+// forces a full redraw. Runs on the alternate screen so the command prompt
+// comes back untouched.
+class Dashboard {
+public:
+    using Source = std::function<void(DashboardView&)>;
+
+    explicit Dashboard(Source source);
+    ~Dashboard();
+
+    // Switches to the alternate screen and redraws every interval on its own
+    // thread. Returns false if stdout is not an ANSI-capable terminal.
+    bool start(std::chrono::milliseconds interval);
+    void stop();
+
+private:
+    void loop(std::chrono::milliseconds interval);
+    void compose(double elapsed_seconds);
+    void flush();
+
+    // Cell writers for the frame being composed; text is clipped at the right edge
+    void put(int row, int col, std::string_view text);
+    void putNumber(int row, int col, long long value, int field);
+
+    Source source;
+    std::atomic<bool> running{ false };
+    std::thread thread;
+    std::mutex wake_mtx;
+    std::condition_variable wake; // Lets stop() interrupt the wait between frames
+
+    DashboardView view;
+    std::vector<uint64_t> last_busy;     // Per-core busy time at the previous frame
+    uint64_t last_instructions = 0;
+    bool primed = false;                 // Baseline taken for the rates above
+    std::chrono::steady_clock::time_point last_frame;
+
+    int width = 0;
+    int height = 0;
+    std::vector<std::string> shown;      // Rows currently on the terminal
+    std::vector<std::string> frame;      // Rows being composed
+    std::string out;
+};
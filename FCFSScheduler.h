@@ -1,6 +1,6 @@
 #pragma once
 
-#include "process.h"
+#include "Process.h"
 #include <queue>
 #include <thread>
 #include <vector>
@@ -8,22 +8,120 @@
 #include <mutex>
 #include <condition_variable>
 #include <list>
+#include <memory>
+#include <deque>
+#include <span>
+#include <functional>
+#include "Affinity.h"
+#include "CorePool.h"
+#include "CoreStats.h"
+#include "CpuGroups.h"
+#include "CycleClock.h"
+#include "Dashboard.h"
+#include "LatencyHistogram.h"
+#include "MemoryManager.h"
+#include "Metrics.h"
+#include "SchedulerDomains.h"
+#include "SoftAffinity.h"
+#include "TimerWheel.h"
 
 class FCFS_Scheduler {
 private:
 
-    std::queue<Process*> process_queue;
+    SchedulerDomains domains;                  // Ready queues and running processes, per group of cores
     std::vector<std::thread> cpu_threads;
     std::atomic<bool> running;
+    std::chrono::steady_clock::time_point start_time;
    // std::mutex mtx;
-    std::condition_variable cv;
     int num_cores;
-    std::list<Process*> running_processes;
-    std::list<Process*> finished_processes;
+    std::vector<ProcessTable::Slot> finished_processes; // Table rows of retired processes, in completion order
 
     mutable std::mutex mtx;
 
     void cpu_worker(int core_id);
+    CoreStats* setup_core(int core_id);
+
+    Affinity::Layout affinity_layout = Affinity::Layout::None;
+    std::vector<std::unique_ptr<CoreStats>> core_stats; // Indexed by core id, allocated by each worker
+    std::atomic<int> cores_ready{ 0 };
+
+    MemoryManager* memory_manager = nullptr;   // Optional; falls back to plain memory accounting
+    std::queue<Process*> pending_processes;    // Admission backlog: waiting for memory
+    std::atomic<size_t> backlog_depth{ 0 };    // Mirrors of the queue sizes for lock-free readers
+    SchedulerLatency latency;                  // Waiting, response and turnaround distributions
+    TimerWheel sleepers;                       // Blocked in SLEEP until their tick comes
+    std::vector<Process*> woken;               // Reused by wake_sleepers
+    std::atomic<size_t> blocked_depth{ 0 };
+    std::atomic<size_t> rejected_count{ 0 };   // Arrivals larger than all of memory, never admitted
+    std::chrono::steady_clock::duration sleep_tick = std::chrono::milliseconds(1); // Free-running tick length
+    std::condition_variable timer_cv;          // Wakes timer_worker when the first sleeper arrives
+    std::thread timer_thread;                  // Turns the wheel and balances the domains in free-running mode
+    void timer_worker();
+
+    CpuGroups groups;                          // Weights and quotas, charged by the cores as they run
+    std::chrono::milliseconds quota_period{ 100 };
+    void release_groups();
+    SoftAffinity affinity;                     // Prefers a process's last core at dispatch, charges migrations
+    uint64_t affinity_now() const;
+    SchedulerDomains::Spec domain_spec;
+    double balance_threshold = 2;
+    std::chrono::milliseconds balance_interval{ 10 };
+    std::atomic<bool> balance_wanted{ false }; // A core ran dry; timer_worker balances idle cores
+    uint64_t next_balance_cycle = 0;           // Lockstep: next full balance
+    void balance(bool idle_only);
+    void request_balance();
+    void make_ready(SchedulerDomains::Domain& domain, Process* proc);
+    void notify_domain(SchedulerDomains::Domain& domain, size_t count);
+    void publish_domain(SchedulerDomains::Domain& domain);
+    uint64_t current_tick() const;
+    void block(Process* proc, uint64_t tick);
+    void wake_sleepers(uint64_t tick);
+    void publish_depths();
+    size_t admit_arrivals(std::span<Process* const> procs);
+    bool admit(Process* proc);
+    Process* dispatch(int core_id, int batch, std::unique_lock<std::mutex>& lock);
+    void admit_pending();
+    void retire(Process* proc);
+    void leave_core(Process* proc);
+    void start_on_core(Process* proc, int core_id);
+    void reclaim_cores();
+    void drop_processes();
+    Process* find_live(const std::string& process_name) const;
+
+public:
+    // Lockstep only: called at each phase boundary to append the arrivals due by `cycle`
+    using ArrivalSource = std::function<void(uint64_t cycle, std::vector<Process*>& arrivals)>;
+
+private:
+    // Lockstep clock: cores run in barrier-synchronized phases and every
+    // scheduling decision is made in lockstep_step, in core order
+    CycleClock::Settings clock_settings;
+    std::unique_ptr<CycleClock> clock;
+    std::vector<Process*> core_process;        // Assigned by the step, run by the core during the next phase
+    ArrivalSource arrival_source;
+    std::vector<Process*> arrivals;            // Reused by lockstep_step
+    uint64_t stop_cycle = 0;                   // Stop the clock here when non-zero
+    uint64_t start_cycle = 0;                  // Where the clock resumes after a restart or restore
+    std::atomic<uint64_t> schedule_hash{ CycleClock::HASH_SEED }; // Every lockstep dispatch folded in
+    void lockstep_worker(int core_id);
+    bool lockstep_step(uint64_t cycle);
+
+    // Coroutine cores: every emulated core is a coroutine on a small host
+    // thread pool instead of a kernel thread of its own
+    bool coroutine_cores = false;
+    int host_threads = 0;                      // Pool size; 0 matches the host
+    std::unique_ptr<CorePool> pool;
+    CoreTask core_task(int core_id);
+    Process* take_next(int core_id, int batch);
+
+    // Parks the core unless a process became ready since it last looked
+    struct WaitForWork {
+        FCFS_Scheduler& scheduler;
+        int core_id;
+        bool await_ready() const { return false; }
+        bool await_suspend(std::coroutine_handle<> handle);
+        void await_resume() const {}
+    };
 
     size_t total_memory;
     size_t used_memory;
@@ -41,17 +139,57 @@ public:
 
 
     void add_process(Process* proc);
+    void add_processes(std::span<Process* const> procs); // One lock acquisition for the whole span
     void start();
     void stop();
     void screen_ls();
     void print_running_processes();
     void print_finished_processes();
+    void print_latency();
     void print_process_details(const std::string& process_name, int screen);
     void print_process_queue_names();
     void SetCpuCore(int cpu_core);
+    void SetAffinity(Affinity::Layout layout);
+    void SetTotalMemory(size_t memory);
+    void SetMemoryManager(MemoryManager* manager);
+    void SetClock(const CycleClock::Settings& settings); // Before start()
+    void SetCoreRuntime(bool coroutines, int host_threads); // Before start()
+    void SetSleepTick(std::chrono::steady_clock::duration tick); // Wall length of a SLEEP tick when not in lockstep
+    void SetArrivalSource(ArrivalSource source, uint64_t stop_at_cycle = 0);
+    void SetDomains(const std::string& spec, double threshold, int interval_ms); // Before start()
+    void SetCpuGroups(const std::string& spec, int period_ms); // Before start(); a malformed spec keeps the groups
+    void SetSoftAffinity(int window_ms, int penalty_cycles); // Before start()
+
+    const std::vector<std::unique_ptr<CoreStats>>& getCoreStats() const { return core_stats; }
+    size_t getFinishedCount() const;
+    size_t getPendingCount() const;
+    size_t getRejectedCount() const { return rejected_count.load(std::memory_order_relaxed); }
+    std::vector<double> getTurnaroundTimes() const; // Seconds, one per finished process
+    const SchedulerLatency& getLatency() const { return latency; }
+    void collectMetrics(MetricsWriter& out) const;  // Short lock; safe from the exporter thread
+    void fillDashboard(DashboardView& view) const;  // Cores, queue depths and completions
+    bool isLockstep() const { return clock_settings.lockstep; }
+    uint64_t getCycle() const { return clock ? clock->now() : 0; }
+    bool isClockStopped() const { return clock && clock->stopped(); }
+    uint64_t getScheduleHash() const { return schedule_hash.load(std::memory_order_relaxed); }
+    size_t getDomainCount() const { return domains.size(); }
+    uint64_t getMigrations() const { return domains.migrations(); } // Processes the balancer moved between domains
+    const CpuGroups& getCpuGroups() const { return groups; }
+    const SoftAffinity& getSoftAffinity() const { return affinity; }
+
+    // Checkpoint support, for a stopped scheduler. save writes the queues and
+    // their processes; load deletes the processes this scheduler holds and
+    // takes the saved ones in their place, on top of a process table and
+    // allocator already restored. start() then carries on from there.
+    void save(Checkpoint::Writer& out, std::chrono::steady_clock::time_point now) const;
+    bool load(const Checkpoint::Reader& in, std::chrono::steady_clock::time_point now);
+    // For a stopped scheduler: deletes the processes it holds, before
+    // initialize starts it again on a new allocator. The table keeps their rows.
+    void clear();
     void ReportUtil();
 
     bool isValidProcessName(const std::string& process_name);
+    bool clone_process(const std::string& parent_name, const std::string& child_name);
     void print_CPU_UTIL();
 
     void vmstat() const;
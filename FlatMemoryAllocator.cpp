@@ -1,5 +1,18 @@
 #include "FlatMemoryAllocator.h"
 #include <iostream>
+#include <algorithm>
+#include <cstdint>
+
+namespace {
+
+struct BlockRecord {
+    uint64_t start_address;
+    uint64_t size;
+    int32_t process_id;
+    uint32_t free;
+};
+
+}
 
 FlatMemoryAllocator::FlatMemoryAllocator(size_t total_memory) : total_memory(total_memory) {
     // Initialize memory blocks with a single large free block
@@ -7,43 +20,52 @@ FlatMemoryAllocator::FlatMemoryAllocator(size_t total_memory) : total_memory(tot
 }
 
 int FlatMemoryAllocator::allocate(int process_id, size_t size) {
-    // Implement allocation logic
-    for (auto& block : memory_blocks) {
+    std::lock_guard<std::mutex> lock(mtx);
+    // First fit
+    for (size_t i = 0; i < memory_blocks.size(); ++i) {
+        MemoryBlock& block = memory_blocks[i];
         if (block.free && block.size >= size) {
+            size_t start = block.start_address;
             if (block.size > size) {
-                // Split the block
-                memory_blocks.emplace_back(block.start_address + size, block.size - size);
+                // Split the block, keeping the remainder right after it
+                MemoryBlock remainder(start + size, block.size - size);
+                block.size = size;
+                memory_blocks.insert(memory_blocks.begin() + i + 1, remainder);
             }
-            block.size = size;
-            block.free = false;
-            block.process_id = process_id;
-            return block.start_address;
+            memory_blocks[i].free = false;
+            memory_blocks[i].process_id = process_id;
+            updateStats();
+            return static_cast<int>(start);
         }
     }
     return -1; // Allocation failed
 }
 
 void FlatMemoryAllocator::deallocate(int process_id) {
-    // Implement deallocation logic
+    std::lock_guard<std::mutex> lock(mtx);
     for (auto& block : memory_blocks) {
         if (block.process_id == process_id) {
             block.free = true;
             block.process_id = -1;
-            // Merge adjacent free blocks
-            for (auto it = memory_blocks.begin(); it != memory_blocks.end(); ++it) {
-                if (it->free && (it + 1) != memory_blocks.end() && (it + 1)->free) {
-                    it->size += (it + 1)->size;
-                    memory_blocks.erase(it + 1);
-                    --it;
-                }
-            }
             break;
         }
     }
+
+    // Merge adjacent free blocks
+    for (size_t i = 0; i + 1 < memory_blocks.size();) {
+        if (memory_blocks[i].free && memory_blocks[i + 1].free) {
+            memory_blocks[i].size += memory_blocks[i + 1].size;
+            memory_blocks.erase(memory_blocks.begin() + i + 1);
+        }
+        else {
+            ++i;
+        }
+    }
+    updateStats();
 }
 
-void FlatMemoryAllocator::printMemoryState() const {
-    // Implement memory state printing logic
+void FlatMemoryAllocator::printMemoryState() {
+    std::lock_guard<std::mutex> lock(mtx);
     std::cout << "Memory State:\n";
     for (const auto& block : memory_blocks) {
         std::cout << "Start Address: " << block.start_address
@@ -54,5 +76,55 @@ void FlatMemoryAllocator::printMemoryState() const {
 }
 
 std::vector<MemoryBlock> FlatMemoryAllocator::getMemoryBlocks() const {
+    std::lock_guard<std::mutex> lock(mtx);
     return memory_blocks;
 }
+
+// External fragmentation: share of free memory outside the largest free block
+void FlatMemoryAllocator::updateStats() {
+    size_t used = 0;
+    size_t free_total = 0;
+    size_t largest_free = 0;
+    for (const auto& block : memory_blocks) {
+        if (block.free) {
+            free_total += block.size;
+            largest_free = std::max(largest_free, block.size);
+        }
+        else {
+            used += block.size;
+        }
+    }
+    used_memory.store(used, std::memory_order_relaxed);
+    fragmentation.store(free_total > 0 ? 1.0 - static_cast<double>(largest_free) / free_total : 0.0, std::memory_order_relaxed);
+}
+
+void FlatMemoryAllocator::save(Checkpoint::Writer& out) const {
+    std::lock_guard<std::mutex> lock(mtx);
+    std::vector<BlockRecord> records;
+    records.reserve(memory_blocks.size());
+    for (const auto& block : memory_blocks) {
+        records.push_back({ block.start_address, block.size, block.process_id, block.free ? 1u : 0u });
+    }
+    out.add(Checkpoint::Section::FlatBlocks, records);
+}
+
+// The blocks must tile memory from address 0 up to total_memory
+bool FlatMemoryAllocator::load(const Checkpoint::Reader& in) {
+    auto records = in.section<BlockRecord>(Checkpoint::Section::FlatBlocks);
+    uint64_t next = 0;
+    for (const BlockRecord& record : records) {
+        if (record.start_address != next) return false;
+        next += record.size;
+    }
+    if (records.empty() || next != total_memory) return false;
+
+    std::lock_guard<std::mutex> lock(mtx);
+    memory_blocks.clear();
+    for (const BlockRecord& record : records) {
+        MemoryBlock& block = memory_blocks.emplace_back(static_cast<size_t>(record.start_address), static_cast<size_t>(record.size));
+        block.free = record.free != 0;
+        block.process_id = record.process_id;
+    }
+    updateStats();
+    return true;
+}
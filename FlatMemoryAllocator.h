@@ -3,6 +3,9 @@
 
 #include <vector>
 #include <cstddef>
+#include <mutex>
+#include <atomic>
+#include "MemoryManager.h"
 
 struct MemoryBlock {
     size_t start_address;
@@ -13,17 +16,31 @@ struct MemoryBlock {
     MemoryBlock(size_t start, size_t sz) : start_address(start), size(sz), free(true), process_id(-1) {}
 };
 
-class FlatMemoryAllocator {
+class FlatMemoryAllocator : public MemoryManager {
 public:
     FlatMemoryAllocator(size_t total_memory);
     int allocate(int process_id, size_t size);
     void deallocate(int process_id);
-    void printMemoryState() const;
+    void printMemoryState() override;
     std::vector<MemoryBlock> getMemoryBlocks() const;
 
+    bool allocateProcess(int process_id, size_t size) override { return allocate(process_id, size) != -1; }
+    void deallocateProcess(int process_id) override { deallocate(process_id); }
+    size_t getTotalMemory() const override { return total_memory; }
+    size_t getUsedMemory() const override { return used_memory.load(std::memory_order_relaxed); }
+    double getFragmentation() const override { return fragmentation.load(std::memory_order_relaxed); }
+    void save(Checkpoint::Writer& out) const override;
+    bool load(const Checkpoint::Reader& in) override;
+
 private:
     size_t total_memory;
-    std::vector<MemoryBlock> memory_blocks;
+    std::vector<MemoryBlock> memory_blocks; // Ordered by start address
+    mutable std::mutex mtx;
+
+    // Refreshed under mtx after every change so readers need no lock
+    std::atomic<size_t> used_memory{ 0 };
+    std::atomic<double> fragmentation{ 0.0 };
+    void updateStats();
 };
 
 #endif // FLATMEMORYALLOCATOR_H
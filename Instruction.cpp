@@ -0,0 +1,79 @@
+#include "Instruction.h"
+#include <algorithm>
+
+namespace {
+
+Instruction make(OpCode op, uint8_t a = 0, uint8_t flags = 0, uint16_t b = 0, uint16_t c = 0) {
+    return Instruction{ op, a, flags, 0, b, c };
+}
+
+// Emits a block whose dynamic leaf count is exactly `budget`.
+void emitBlock(std::vector<Instruction>& out, int budget, int depth, int& declared, std::mt19937& gen) {
+    std::uniform_int_distribution<> kind_dist(0, 9);
+    std::uniform_int_distribution<> value_dist(0, 100);
+
+    while (budget > 0) {
+        int kind = kind_dist(gen);
+
+        // FOR loop: repeats * body must fit in what is left of the budget
+        if (kind == 0 && depth < MAX_FOR_DEPTH && budget >= 4) {
+            int repeats = std::uniform_int_distribution<>(2, std::min(5, budget / 2))(gen);
+            int body = std::uniform_int_distribution<>(1, std::min(8, budget / repeats))(gen);
+
+            out.push_back(make(OpCode::FOR_BEGIN, 0, IMM_B, static_cast<uint16_t>(repeats)));
+            uint32_t start = static_cast<uint32_t>(out.size());
+            emitBlock(out, body, depth + 1, declared, gen);
+            out.push_back(make(OpCode::FOR_END, 0, 0, static_cast<uint16_t>(start & 0xFFFF), static_cast<uint16_t>(start >> 16)));
+
+            budget -= body * repeats;
+            continue;
+        }
+
+        // Arithmetic needs at least one declared variable to work on
+        if (declared == 0 && (kind >= 5 && kind <= 8)) {
+            kind = 3;
+        }
+
+        std::uniform_int_distribution<> slot_dist(0, std::max(declared - 1, 0));
+        switch (kind) {
+        case 1:
+        case 2:
+            out.push_back(make(OpCode::PRINT, 0, IMM_A));
+            break;
+        case 3:
+        case 4: {
+            uint8_t slot = static_cast<uint8_t>(declared < MAX_VARIABLES ? declared++ : slot_dist(gen));
+            out.push_back(make(OpCode::DECLARE, slot, IMM_B, static_cast<uint16_t>(value_dist(gen))));
+            break;
+        }
+        case 5:
+        case 6:
+        case 7:
+        case 8: {
+            OpCode op = (kind <= 6) ? OpCode::ADD : OpCode::SUBTRACT;
+            uint8_t dst = static_cast<uint8_t>(slot_dist(gen));
+            uint16_t b = static_cast<uint16_t>(slot_dist(gen));
+            uint16_t c = static_cast<uint16_t>(value_dist(gen));
+            out.push_back(make(op, dst, IMM_C, b, c));
+            break;
+        }
+        default:
+            out.push_back(make(OpCode::SLEEP, 0, IMM_B, static_cast<uint16_t>(std::uniform_int_distribution<>(1, 3)(gen))));
+            break;
+        }
+        --budget;
+    }
+}
+
+}
+
+std::vector<Instruction> generateProgram(int instructions, std::mt19937& gen) {
+    std::vector<Instruction> program;
+    program.reserve(static_cast<size_t>(std::max(instructions, 0)) + 1);
+
+    int declared = 0;
+    emitBlock(program, instructions, 0, declared, gen);
+    program.push_back(make(OpCode::HALT));
+    program.shrink_to_fit();
+    return program;
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include <cstdint>
+#include <random>
+#include <vector>
+
+// Limits of the emulated instruction set.
+constexpr int MAX_VARIABLES = 32;   // Variable slots per process (uint16 each)
+constexpr int MAX_FOR_DEPTH = 3;    // Maximum nesting of FOR loops
+
+enum class OpCode : uint8_t {
+    PRINT,      // PRINT("Hello world from <name>!"), or the value of variable a when IMM_A is clear
+    DECLARE,    // DECLARE(var a, value b)
+    ADD,        // ADD(var a, b, c)      a = b + c, clamped to uint16
+    SUBTRACT,   // SUBTRACT(var a, b, c) a = b - c, clamped to uint16
+    SLEEP,      // SLEEP(b)              relinquish the CPU for b ticks
+    FOR_BEGIN,  // FOR(..., b)           push a loop counter of b repeats
+    FOR_END,    //                       loop back to target() while the counter is non-zero
+    HALT        // End of program
+};
+
+// Operand flags: when set the operand is an immediate, otherwise a variable slot.
+constexpr uint8_t IMM_A = 0x1;
+constexpr uint8_t IMM_B = 0x2;
+constexpr uint8_t IMM_C = 0x4;
+
+// Fixed-width 8-byte bytecode instruction.
+struct Instruction {
+    OpCode op;
+    uint8_t a;       // Destination variable slot
+    uint8_t flags;   // IMM_* operand flags
+    uint8_t pad;
+    uint16_t b;
+    uint16_t c;
+
+    // FOR_END stores its 32-bit jump target across b and c.
+    uint32_t target() const { return static_cast<uint32_t>(b) | (static_cast<uint32_t>(c) << 16); }
+};
+
+// Interpreter state owned by each process.
+struct CpuState {
+    uint32_t pc = 0;
+    int sleep_ticks = 0;
+    uint8_t loop_depth = 0;
+    uint8_t stored = 0; // Set when a variable is written; the scheduler clears it when it reports the write
+    uint16_t loop_counters[MAX_FOR_DEPTH] = {};
+    uint16_t variables[MAX_VARIABLES] = {};
+};
+
+// Generates a random program whose dynamic instruction count (loop bodies
+// counted once per iteration, loop control not counted) is exactly `instructions`.
+std::vector<Instruction> generateProgram(int instructions, std::mt19937& gen);
@@ -0,0 +1,143 @@
+#include "Interpreter.h"
+#include <algorithm>
+#include <chrono>
+
+#if defined(__GNUC__) || defined(__clang__)
+#define CSOPESY_COMPUTED_GOTO 1
+#endif
+
+std::atomic<uint64_t> Interpreter::instructions_executed{ 0 };
+std::atomic<uint64_t> Interpreter::busy_nanoseconds{ 0 };
+
+namespace {
+
+inline uint16_t operand(const CpuState& cpu, uint16_t value, bool immediate) {
+    return immediate ? value : cpu.variables[value % MAX_VARIABLES];
+}
+
+inline uint16_t clampToU16(int value) {
+    return static_cast<uint16_t>(std::min(std::max(value, 0), 65535));
+}
+
+}
+
+int Interpreter::run(Process& proc, int budget) {
+    auto begin = std::chrono::steady_clock::now();
+
+    CpuState& cpu = proc.cpu;
+    const Instruction* code = proc.program.data();
+    const Instruction* ip = code + cpu.pc;
+    int cycles = 0;
+    int executed = 0;
+
+#ifdef CSOPESY_COMPUTED_GOTO
+    // Must match the order of OpCode
+    static void* const dispatch_table[] = {
+        &&op_print, &&op_declare, &&op_add, &&op_subtract, &&op_sleep, &&op_for_begin, &&op_for_end, &&op_halt
+    };
+#define DISPATCH() goto *dispatch_table[static_cast<uint8_t>(ip->op)]
+#define DISPATCH_BEGIN() DISPATCH();
+#define CASE(label, opcode) label:
+#define NEXT() DISPATCH()
+#else
+#define DISPATCH_BEGIN() switch (ip->op)
+#define CASE(label, opcode) case opcode:
+#define NEXT() continue
+#endif
+// Leaf instructions cost one cycle and end the slice when the budget runs out
+#define RETIRE() do { ++ip; ++executed; if (++cycles >= budget) goto done; } while (0)
+
+    if (cycles >= budget) goto done;
+
+#ifndef CSOPESY_COMPUTED_GOTO
+    for (;;) {
+#endif
+    DISPATCH_BEGIN() {
+        CASE(op_print, OpCode::PRINT) {
+            if (proc.log_file) {
+                if (ip->flags & IMM_A) {
+                    *proc.log_file << "Hello world from " << proc.name << "!\n";
+                }
+                else {
+                    *proc.log_file << "Value from: " << cpu.variables[ip->a % MAX_VARIABLES] << "\n";
+                }
+            }
+            RETIRE();
+            NEXT();
+        }
+        CASE(op_declare, OpCode::DECLARE) {
+            cpu.variables[ip->a % MAX_VARIABLES] = ip->b;
+            cpu.stored = 1;
+            RETIRE();
+            NEXT();
+        }
+        CASE(op_add, OpCode::ADD) {
+            int sum = operand(cpu, ip->b, ip->flags & IMM_B) + operand(cpu, ip->c, ip->flags & IMM_C);
+            cpu.variables[ip->a % MAX_VARIABLES] = clampToU16(sum);
+            cpu.stored = 1;
+            RETIRE();
+            NEXT();
+        }
+        CASE(op_subtract, OpCode::SUBTRACT) {
+            int difference = operand(cpu, ip->b, ip->flags & IMM_B) - operand(cpu, ip->c, ip->flags & IMM_C);
+            cpu.variables[ip->a % MAX_VARIABLES] = clampToU16(difference);
+            cpu.stored = 1;
+            RETIRE();
+            NEXT();
+        }
+        CASE(op_sleep, OpCode::SLEEP) {
+            // The process gives up the core; the scheduler blocks it for b ticks
+            cpu.sleep_ticks = ip->b;
+            ++ip;
+            ++executed;
+            ++cycles;
+            goto done;
+        }
+        CASE(op_for_begin, OpCode::FOR_BEGIN) {
+            if (cpu.loop_depth < MAX_FOR_DEPTH) {
+                cpu.loop_counters[cpu.loop_depth++] = ip->b;
+            }
+            ++ip;
+            NEXT();
+        }
+        CASE(op_for_end, OpCode::FOR_END) {
+            if (cpu.loop_depth > 0 && --cpu.loop_counters[cpu.loop_depth - 1] > 0) {
+                ip = code + ip->target();
+            }
+            else {
+                if (cpu.loop_depth > 0) --cpu.loop_depth;
+                ++ip;
+            }
+            NEXT();
+        }
+        CASE(op_halt, OpCode::HALT) {
+            goto done;
+        }
+    }
+#ifndef CSOPESY_COMPUTED_GOTO
+    }
+#endif
+
+#undef DISPATCH
+#undef DISPATCH_BEGIN
+#undef CASE
+#undef NEXT
+#undef RETIRE
+
+done:
+    cpu.pc = static_cast<uint32_t>(ip - code);
+    // Only the owning core writes progress; readers just need a coherent value
+    int progress = proc.executed_commands.load(std::memory_order_relaxed) + executed;
+    proc.executed_commands.store(std::min(progress, proc.total_commands), std::memory_order_relaxed);
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin);
+    instructions_executed.fetch_add(executed, std::memory_order_relaxed);
+    busy_nanoseconds.fetch_add(static_cast<uint64_t>(elapsed.count()), std::memory_order_relaxed);
+    return cycles;
+}
+
+double Interpreter::getInstructionsPerSecond() {
+    uint64_t ns = busy_nanoseconds.load(std::memory_order_relaxed);
+    if (ns == 0) return 0.0;
+    return static_cast<double>(instructions_executed.load(std::memory_order_relaxed)) * 1e9 / static_cast<double>(ns);
+}
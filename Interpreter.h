@@ -0,0 +1,22 @@
+#pragma once
+#include "Process.h"
+#include <atomic>
+#include <cstdint>
+
+// Executes process bytecode. Uses computed-goto threaded dispatch where the
+// compiler supports it (GCC/Clang) and a switch loop otherwise (MSVC).
+class Interpreter {
+public:
+    // Runs up to `budget` cycles of the process's program. Each executed
+    // instruction costs one cycle; loop control is free. SLEEP ends the slice
+    // early and leaves its tick count in cpu.sleep_ticks for the scheduler,
+    // which blocks the process and clears it. Returns the number of cycles consumed.
+    static int run(Process& proc, int budget);
+
+    static uint64_t getInstructionsExecuted() { return instructions_executed.load(std::memory_order_relaxed); }
+    static double getInstructionsPerSecond(); // Per core: instructions over summed time spent in run()
+
+private:
+    static std::atomic<uint64_t> instructions_executed;
+    static std::atomic<uint64_t> busy_nanoseconds;
+};
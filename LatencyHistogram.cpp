@@ -0,0 +1,49 @@
+#include "LatencyHistogram.h"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+size_t LatencyHistogram::bucketOf(uint64_t value) {
+    if (value < SUB_BUCKETS) {
+        return static_cast<size_t>(value);
+    }
+    // Shift so the top SUB_BUCKET_BITS bits remain: value >> shift is in [16, 31]
+    int shift = std::bit_width(value) - SUB_BUCKET_BITS;
+    return static_cast<size_t>(SUB_BUCKETS + (shift - 1) * HALF_BUCKETS + ((value >> shift) - HALF_BUCKETS));
+}
+
+uint64_t LatencyHistogram::highestValueIn(size_t bucket) {
+    if (bucket < SUB_BUCKETS) {
+        return bucket;
+    }
+    uint64_t shift = (bucket - SUB_BUCKETS) / HALF_BUCKETS + 1;
+    uint64_t sub = (bucket - SUB_BUCKETS) % HALF_BUCKETS + HALF_BUCKETS;
+    return ((sub + 1) << shift) - 1;
+}
+
+void LatencyHistogram::record(uint64_t nanoseconds) {
+    buckets[bucketOf(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+    total.fetch_add(1, std::memory_order_relaxed);
+    total_ns.fetch_add(nanoseconds, std::memory_order_relaxed);
+
+    uint64_t seen = maximum.load(std::memory_order_relaxed);
+    while (nanoseconds > seen && !maximum.compare_exchange_weak(seen, nanoseconds, std::memory_order_relaxed)) {
+    }
+}
+
+uint64_t LatencyHistogram::percentile(double percent) const {
+    uint64_t samples = count();
+    if (samples == 0) return 0;
+
+    uint64_t target = static_cast<uint64_t>(std::ceil(percent / 100.0 * samples));
+    target = std::clamp<uint64_t>(target, 1, samples);
+
+    uint64_t seen = 0;
+    for (size_t bucket = 0; bucket < BUCKET_COUNT; ++bucket) {
+        seen += buckets[bucket].load(std::memory_order_relaxed);
+        if (seen >= target) {
+            return std::min(highestValueIn(bucket), max());
+        }
+    }
+    return max();
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+// Lock-free HDR-style histogram of nanosecond latencies. Values are bucketed
+// log-linearly: exact below 32ns, then 16 sub-buckets per power of two, so
+// any recorded value is reported within ~6% of its true magnitude across the
+// whole uint64 range. record() is a single relaxed fetch_add.
+class LatencyHistogram {
+public:
+    void record(uint64_t nanoseconds);
+
+    uint64_t count() const { return total.load(std::memory_order_relaxed); }
+    uint64_t max() const { return maximum.load(std::memory_order_relaxed); }
+    uint64_t sum() const { return total_ns.load(std::memory_order_relaxed); }
+    // Value at or below which `percent` of the recorded samples fall (0 when empty).
+    uint64_t percentile(double percent) const;
+
+private:
+    static constexpr int SUB_BUCKET_BITS = 5;
+    static constexpr uint64_t SUB_BUCKETS = 1ULL << SUB_BUCKET_BITS;  // 32
+    static constexpr uint64_t HALF_BUCKETS = SUB_BUCKETS / 2;         // 16
+    static constexpr size_t BUCKET_COUNT = SUB_BUCKETS + (64 - SUB_BUCKET_BITS) * HALF_BUCKETS;
+
+    static size_t bucketOf(uint64_t value);
+    static uint64_t highestValueIn(size_t bucket);
+
+    std::array<std::atomic<uint64_t>, BUCKET_COUNT> buckets{};
+    std::atomic<uint64_t> total{ 0 };
+    std::atomic<uint64_t> maximum{ 0 };
+    std::atomic<uint64_t> total_ns{ 0 };
+};
+
+// Latency distributions of one scheduler, recorded by its cores.
+struct SchedulerLatency {
+    LatencyHistogram waiting;    // Time spent off a core between arrival and completion
+    LatencyHistogram response;   // Arrival to first dispatch
+    LatencyHistogram turnaround; // Arrival to completion
+};
@@ -6,35 +6,96 @@
 #include "Console.h"
 #include "Config.h"
 #include "RRScheduler.h"
-#include "PagingAllocator.h"
-#include "FlatMemoryAllocator.h"
+#include "MemoryManager.h"
+#include "BatchRunner.h"
+#include "Interpreter.h"
+#include "Affinity.h"
+#include "Metrics.h"
+#include "Dashboard.h"
+#include "Tracer.h"
+#include "Checkpoint.h"
+#include "ProcessTable.h"
+#include "ProcessGenerator.h"
+#include "ReportRenderer.h"
 #include <random>
 #include <thread>
 #include <sstream>
 #include <vector>
 #include <memory>
+#include <atomic>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <shared_mutex>
+
+int main(int argc, char* argv[]) {
+    if (argc > 1 && std::string(argv[1]) == "--batch") {
+        return runBatch(argc, argv);
+    }
 
-int main() {
     displayHeader();
     std::string command;
 
     ConsoleManager console_manager;
     bool running = true;
 
-    FlatMemoryAllocator* flat_allocator = nullptr;
-    PagingAllocator* paging_allocator = nullptr;
-    bool is_paging = false;
-
-    const auto& config = Config::GetConfigParameters();
+    MemoryManager* memory_manager = nullptr;
 
     // Initialize scheduler
-    FCFS_Scheduler fcfs_scheduler(0, config.max_overall_mem);
-    RR_Scheduler rr_scheduler(0, 0, config.max_overall_mem);
+    FCFS_Scheduler fcfs_scheduler(0, 0);
+    RR_Scheduler rr_scheduler(0, 0, 0);
+    std::string active_scheduler = ""; // Fixed at initialize; a reload cannot switch schedulers
+    Config::Snapshot started_config;    // What the scheduler and allocator were built from; reloads do not resize them
+
+    // Test process generator. Its producers hold submit_mtx shared while they
+    // create and submit a burst; fork, checkpoint and restore take it
+    // exclusively to keep the process table still.
+    std::atomic<int> process_count{ 0 };
+    std::shared_mutex submit_mtx;
+    ProcessGenerator generator([&](std::span<Process* const> burst) {
+        if (active_scheduler == "fcfs") {
+            fcfs_scheduler.add_processes(burst);
+        }
+        else if (active_scheduler == "rr") {
+            rr_scheduler.add_processes(burst);
+        }
+        else {
+            for (Process* proc : burst) delete proc;
+        }
+        }, submit_mtx, process_count);
+
+    // Metrics of whichever scheduler and allocator are active
+    auto collect_metrics = [&](MetricsWriter& out) {
+        if (active_scheduler == "fcfs") {
+            fcfs_scheduler.collectMetrics(out);
+        }
+        else if (active_scheduler == "rr") {
+            rr_scheduler.collectMetrics(out);
+        }
+        if (memory_manager) {
+            memory_manager->collectMetrics(out);
+        }
+        generator.collectMetrics(out);
+    };
+    std::unique_ptr<MetricsExporter> metrics_exporter;
+
+    // Live view for the top command
+    auto fill_dashboard = [&](DashboardView& view) {
+        view.scheduler = active_scheduler;
+        if (active_scheduler == "fcfs") {
+            fcfs_scheduler.fillDashboard(view);
+        }
+        else if (active_scheduler == "rr") {
+            rr_scheduler.fillDashboard(view);
+        }
+        view.memory_total = memory_manager ? memory_manager->getTotalMemory() : 0;
+        view.memory_used = memory_manager ? memory_manager->getUsedMemory() : 0;
+        view.page_faults = memory_manager ? memory_manager->getPageFaults() : 0;
+        view.instructions = Interpreter::getInstructionsExecuted();
+    };
 
-    // Initialize scheduling test
-    std::thread scheduler_thread;
-    int process_count = 0;
-    bool scheduler_testing = false;
     std::string screen_process_name = "";
     bool initialized = false;
 
@@ -52,112 +113,386 @@ int main() {
 
         if (tokens.empty()) continue;
 
+        Config::Snapshot config = Config::Current();
+
         if (tokens[0] == "initialize") {
+            if (initialized) {
+                // Start over: nothing may still run on the old scheduler or allocator
+                generator.stop();
+                metrics_exporter.reset();
+                std::lock_guard<std::shared_mutex> submit_lock(submit_mtx);
+                if (active_scheduler == "fcfs") {
+                    fcfs_scheduler.stop();
+                    fcfs_scheduler.clear();
+                }
+                else if (active_scheduler == "rr") {
+                    rr_scheduler.stop();
+                    rr_scheduler.clear();
+                }
+                delete memory_manager;
+                memory_manager = nullptr;
+                initialized = false;
+            }
             Config::Initialize();
             std::cout << "Config initialized with \"config.txt\" parameters" << std::endl;
 
-            const auto& config = Config::GetConfigParameters();
+            config = Config::Current();
+            active_scheduler = config->scheduler;
+            started_config = config;
 
             // Choose memory allocator
-            if (config.max_overall_mem == config.mem_per_frame) {
-                flat_allocator = new FlatMemoryAllocator(config.max_overall_mem);
-                is_paging = false;
+            memory_manager = MemoryManager::create(*config);
+            if (config->max_overall_mem == config->mem_per_frame) {
                 std::cout << "Flat memory allocator initialized.\n";
             }
+            else if (config->huge_page_size > 0) {
+                std::cout << "Paging memory allocator initialized with " << config->huge_page_size << " KB huge pages.\n";
+            }
             else {
-                paging_allocator = new PagingAllocator(config.max_overall_mem, config.mem_per_frame);
-                is_paging = true;
                 std::cout << "Paging memory allocator initialized.\n";
             }
 
+            Affinity::Layout layout = Affinity::parseLayout(config->cpu_affinity);
+            if (layout != Affinity::Layout::None) {
+                std::cout << "Pinning cores (" << Affinity::layoutName(layout) << ") across "
+                    << Affinity::topology().size() << " host CPUs on " << Affinity::numaNodeCount() << " NUMA node(s).\n";
+            }
+
+            CycleClock::Settings clock{ config->clock_mode == "lockstep", static_cast<uint64_t>(config->clock_sync_ticks), config->clock_hz, config->clock_pace == "fast" };
+            if (clock.lockstep) {
+                std::cout << "Cores run in lockstep, " << clock.ticks_per_sync << " cycle(s) per phase";
+                if (clock.fast) {
+                    std::cout << " as fast as the host allows.\n";
+                }
+                else {
+                    std::cout << " at " << clock.hz << " Hz.\n";
+                }
+            }
+
+            bool coroutine_cores = config->core_runtime == "coroutines";
+            if (coroutine_cores && !clock.lockstep) {
+                int pool_threads = config->host_threads > 0 ? config->host_threads : std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+                std::cout << "Running " << config->num_cpu << " cores as coroutines on " << pool_threads << " host thread(s).\n";
+            }
+
             // Initialize the scheduler
-            if (config.scheduler == "fcfs") {
-                fcfs_scheduler.SetCpuCore(config.num_cpu);
+            if (config->scheduler == "fcfs") {
+                fcfs_scheduler.SetCpuCore(config->num_cpu);
+                fcfs_scheduler.SetTotalMemory(config->max_overall_mem);
+                fcfs_scheduler.SetAffinity(layout);
+                fcfs_scheduler.SetDomains(config->scheduler_domains, config->balance_threshold, config->balance_interval_ms);
+                fcfs_scheduler.SetCpuGroups(config->cpu_groups, config->cpu_quota_period_ms);
+                fcfs_scheduler.SetSoftAffinity(config->affinity_window_ms, config->migration_penalty_cycles);
+                fcfs_scheduler.SetMemoryManager(memory_manager);
+                fcfs_scheduler.SetClock(clock);
+                fcfs_scheduler.SetCoreRuntime(coroutine_cores, config->host_threads);
+                fcfs_scheduler.SetSleepTick(std::chrono::microseconds(config->sleep_tick_us));
                 fcfs_scheduler.start();
             }
-            else if (config.scheduler == "rr") {
-                rr_scheduler.SetCpuCore(config.num_cpu);
-                rr_scheduler.SetQuantum(config.quantum_cycles);
+            else if (config->scheduler == "rr") {
+                rr_scheduler.SetCpuCore(config->num_cpu);
+                rr_scheduler.SetTotalMemory(config->max_overall_mem);
+                rr_scheduler.SetAffinity(layout);
+                rr_scheduler.SetDomains(config->scheduler_domains, config->balance_threshold, config->balance_interval_ms);
+                rr_scheduler.SetCpuGroups(config->cpu_groups, config->cpu_quota_period_ms);
+                rr_scheduler.SetSoftAffinity(config->affinity_window_ms, config->migration_penalty_cycles);
+                rr_scheduler.SetMemoryManager(memory_manager);
+                rr_scheduler.SetQuantum(config->quantum_cycles);
+                rr_scheduler.SetAdaptiveQuantum(QuantumController::fromConfig(*config));
+                rr_scheduler.SetClock(clock);
+                rr_scheduler.SetCoreRuntime(coroutine_cores, config->host_threads);
+                rr_scheduler.SetSleepTick(std::chrono::microseconds(config->sleep_tick_us));
                 rr_scheduler.start();
             }
+
+            if (config->metrics_port != 0 || !config->metrics_file.empty()) {
+                metrics_exporter.reset(new MetricsExporter(collect_metrics));
+                if (config->metrics_port != 0) {
+                    if (metrics_exporter->serveHttp(config->metrics_port)) {
+                        std::cout << "Serving metrics on http://127.0.0.1:" << config->metrics_port << "/metrics\n";
+                    }
+                    else {
+                        std::cout << "Could not listen on metrics port " << config->metrics_port << ".\n";
+                    }
+                }
+                if (!config->metrics_file.empty()) {
+                    metrics_exporter->writeFile(config->metrics_file, config->metrics_interval);
+                    std::cout << "Writing metrics to " << config->metrics_file << " every " << config->metrics_interval << "s\n";
+                }
+            }
             initialized = true;
         }
         else if (tokens[0] == "scheduler-test") {
-            std::random_device rd;
-            std::mt19937 gen(rd());
-            std::uniform_int_distribution<> dist(config.min_ins, config.max_ins);
-
-            if (!scheduler_testing) {
-                scheduler_testing = true;
-                scheduler_thread = std::thread([&]() {
-                    while (scheduler_testing) {
-                        int commands_per_process = dist(gen);
-
-                        if (Config::GetConfigParameters().scheduler == "fcfs") {
-                            fcfs_scheduler.add_process(new Process("process" + std::to_string(++process_count), commands_per_process, config.max_overall_mem));
-                        }
-                        else if (Config::GetConfigParameters().scheduler == "rr") {
-                            rr_scheduler.add_process(new Process("process" + std::to_string(++process_count), commands_per_process, config.max_overall_mem));
-                        }
-
-                        std::this_thread::sleep_for(std::chrono::milliseconds((int)(config.batch_process_freq * 1000)));
-                    }
-                    });
-                scheduler_thread.detach();
-
-                std::cout << "Scheduler test execution started.\n";
+            if (!generator.running()) {
+                // Generated processes are dealt round the CPU groups
+                size_t group_count = active_scheduler == "fcfs" ? fcfs_scheduler.getCpuGroups().size() : rr_scheduler.getCpuGroups().size();
+                ProcessGenerator::Settings settings = ProcessGenerator::fromConfig(*config, static_cast<int>(group_count));
+                generator.start(settings);
+                std::cout << "Scheduler test execution started: " << settings.rate << " processes/s, " << config->arrival_model << " arrivals, "
+                    << settings.threads << (settings.threads == 1 ? " producer.\n" : " producers.\n");
             }
             else {
                 std::cout << "Scheduler test is already running.\n";
             }
         }
+        else if (tokens[0] == "scheduler-stop") {
+            if (generator.running()) {
+                generator.stop();
+                ReportRenderer report;
+                report.append("Scheduler test stopped: ");
+                generator.appendReport(report);
+                std::cout << report.str();
+            }
+            else {
+                std::cout << "Scheduler test is not running.\n";
+            }
+        }
         else if (tokens[0] == "process-smi") {
-            if (is_paging && paging_allocator) {
-                paging_allocator->printMemoryState();
+            if (memory_manager) {
+                memory_manager->printMemoryState();
             }
-            else if (flat_allocator) {
-                flat_allocator->printMemoryState();
+        }
+        else if (tokens[0] == "fork" && tokens.size() > 1) {
+            // Starts a copy of a live process that shares its memory until it writes
+            if (!initialized) {
+                std::cout << "Run initialize first.\n";
+                continue;
+            }
+            std::lock_guard<std::shared_mutex> submit_lock(submit_mtx);
+            std::string child_name = tokens.size() > 2 ? tokens[2] : "process" + std::to_string(process_count + 1);
+            bool free_name = active_scheduler == "fcfs" ? fcfs_scheduler.isValidProcessName(child_name) : rr_scheduler.isValidProcessName(child_name);
+            if (!free_name) {
+                std::cout << "Process name " << child_name << " is taken.\n";
+                continue;
+            }
+            bool cloned = active_scheduler == "fcfs" ? fcfs_scheduler.clone_process(tokens[1], child_name) : rr_scheduler.clone_process(tokens[1], child_name);
+            if (!cloned) {
+                std::cout << "No running process named " << tokens[1] << ".\n";
+                continue;
             }
+            if (tokens.size() <= 2) {
+                ++process_count;
+            }
+            std::cout << "Forked " << child_name << " from " << tokens[1] << ".\n";
         }
         else if (tokens[0] == "screen" && tokens[1] == "-ls") {
-            if (config.scheduler == "fcfs") {
+            if (active_scheduler == "fcfs") {
                 fcfs_scheduler.screen_ls();
             }
-            else if (config.scheduler == "rr") {
+            else if (active_scheduler == "rr") {
                 rr_scheduler.screen_ls();
             }
         }
         else if (tokens[0] == "vmstat") {
-            std::cout << "Total memory: " << config.max_overall_mem << " KB\n";
-            std::cout << "Used memory: " << config.max_overall_mem << " KB\n";
-            std::cout << "Free memory: 0 KB\n";
+            size_t total_memory = memory_manager ? memory_manager->getTotalMemory() : 0;
+            size_t used_memory = memory_manager ? memory_manager->getUsedMemory() : 0;
+            std::cout << "Total memory: " << total_memory << " KB\n";
+            std::cout << "Used memory: " << used_memory << " KB\n";
+            std::cout << "Free memory: " << total_memory - used_memory << " KB\n";
+            if (memory_manager && started_config->max_overall_mem != started_config->mem_per_frame) {
+                MemoryManager::PagingStats paging = memory_manager->getPagingStats();
+                std::cout << "Page faults: " << memory_manager->getPageFaults() << "\n";
+                std::cout << "Page table entries: " << paging.page_table_entries << " (" << paging.page_table_bytes / 1024 << " KB)\n";
+                if (paging.huge_page_kb > 0) {
+                    std::cout << "Huge pages in use: " << paging.huge_pages_used << " x " << paging.huge_page_kb << " KB\n";
+                    std::cout << "Huge page faults: " << paging.huge_page_faults << "\n";
+                    std::cout << "Huge page promotions / demotions: " << paging.promotions << " / " << paging.demotions << "\n";
+                }
+                if (started_config->working_set_window > 0) {
+                    std::cout << "Working sets: " << paging.working_set_frames << " frames, " << paging.working_set_evictions << " pages evicted outside them\n";
+                }
+                if (started_config->prefetch_pages > 0) {
+                    std::cout << "Prefetched pages: " << paging.prefetched_pages << " (" << paging.prefetch_hits << " used)\n";
+                }
+                if (started_config->swapper_free_frames > 0 && started_config->clock_mode != "lockstep") {
+                    std::cout << "Swapper: " << paging.swapper_page_outs << " pages out (" << paging.swapper_swap_outs << " idle processes), "
+                        << paging.swapper_page_ins << " pages in ahead of dispatch, " << paging.frame_waits << " faults waited for a frame\n";
+                }
+                std::cout << "Shared frames: " << paging.shared_frames << " (" << paging.forks << " forks, " << paging.cow_copies << " copy-on-write copies)\n";
+            }
 
             size_t idle_ticks = 0;
             size_t active_ticks = 0;
+            bool lockstep = false;
+            uint64_t cycle = 0;
 
-            if (config.scheduler == "fcfs") {
+            if (active_scheduler == "fcfs") {
                 idle_ticks = fcfs_scheduler.getIdleTicks();
                 active_ticks = fcfs_scheduler.getActiveTicks();
+                lockstep = fcfs_scheduler.isLockstep();
+                cycle = fcfs_scheduler.getCycle();
             }
-            else if (config.scheduler == "rr") {
+            else if (active_scheduler == "rr") {
                 idle_ticks = rr_scheduler.getIdleTicks();
                 active_ticks = rr_scheduler.getActiveTicks();
+                lockstep = rr_scheduler.isLockstep();
+                cycle = rr_scheduler.getCycle();
             }
 
             std::cout << "Idle CPU ticks: " << idle_ticks << "\n";
             std::cout << "Active CPU ticks: " << active_ticks << "\n";
+            if (lockstep) {
+                std::cout << "Global cycle: " << cycle << "\n";
+            }
+            std::cout << "Instructions executed: " << Interpreter::getInstructionsExecuted() << "\n";
+            std::cout << "Interpreter throughput: " << static_cast<uint64_t>(Interpreter::getInstructionsPerSecond()) << " instructions/s per core\n";
+        }
+        else if (tokens[0] == "top") {
+            // top [refresh-ms]; Enter returns to the prompt
+            int refresh_ms = tokens.size() > 1 ? std::atoi(tokens[1].c_str()) : 500;
+            Dashboard dashboard(fill_dashboard);
+            if (dashboard.start(std::chrono::milliseconds(std::max(refresh_ms, 50)))) {
+                std::getline(std::cin, command);
+                dashboard.stop();
+            }
+            else {
+                std::cout << "top needs an ANSI-capable terminal.\n";
+            }
+        }
+        else if (tokens[0] == "trace" && tokens.size() > 1 && tokens[1] == "start") {
+            Tracer::start();
+            std::cout << "Tracing scheduler events.\n";
+        }
+        else if (tokens[0] == "trace" && tokens.size() > 1 && tokens[1] == "stop") {
+            // trace stop [file]; load the file in Perfetto or chrome://tracing
+            std::string path = tokens.size() > 2 ? tokens[2] : "csopesy-trace.json";
+            Tracer::stop();
+            if (Tracer::writeJson(path)) {
+                std::cout << "Trace written to " << path << "\n";
+            }
+            else {
+                std::cout << "Could not write trace to " << path << "\n";
+            }
+        }
+        else if (tokens[0] == "checkpoint" && tokens.size() > 1) {
+            // Stops the cores just long enough to copy the state out
+            if (!initialized) {
+                std::cout << "Run initialize first.\n";
+                continue;
+            }
+            std::lock_guard<std::shared_mutex> submit_lock(submit_mtx);
+            auto began = std::chrono::steady_clock::now();
+            Checkpoint::Writer out;
+            Checkpoint::Info info{};
+            std::strncpy(info.scheduler, active_scheduler.c_str(), sizeof(info.scheduler) - 1);
+            info.max_overall_mem = started_config->max_overall_mem;
+            info.mem_per_frame = started_config->mem_per_frame;
+            info.huge_page_size = started_config->huge_page_size;
+            info.saved_at = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+            info.num_cpu = static_cast<uint32_t>(started_config->num_cpu);
+
+            if (active_scheduler == "fcfs") {
+                fcfs_scheduler.stop();
+                fcfs_scheduler.save(out, began);
+            }
+            else {
+                rr_scheduler.stop();
+                rr_scheduler.save(out, began);
+            }
+            info.rows = ProcessTable::size();
+            out.add(Checkpoint::Section::Info, info);
+            ProcessTable::save(out, began);
+            memory_manager->save(out);
+            if (active_scheduler == "fcfs") {
+                fcfs_scheduler.start();
+            }
+            else {
+                rr_scheduler.start();
+            }
+            auto paused = std::chrono::steady_clock::now() - began;
+
+            // The cores are already running again while the file is written
+            if (out.writeFile(tokens[1])) {
+                std::cout << "Checkpoint of " << info.rows << " processes written to " << tokens[1] << " (" << out.size() / 1024 << " KB, cores paused "
+                    << std::chrono::duration_cast<std::chrono::milliseconds>(paused).count() << " ms).\n";
+            }
+            else {
+                std::cout << "Could not write checkpoint to " << tokens[1] << "\n";
+            }
+        }
+        else if (tokens[0] == "restore" && tokens.size() > 1) {
+            // Replaces the running state with a checkpoint taken under the same scheduler and memory sizes
+            if (!initialized) {
+                std::cout << "Run initialize first.\n";
+                continue;
+            }
+            auto began = std::chrono::steady_clock::now();
+            Checkpoint::Reader in;
+            std::string error;
+            if (!in.open(tokens[1], error)) {
+                std::cout << "Cannot restore: " << error << ".\n";
+                continue;
+            }
+            const Checkpoint::Info* info = in.record<Checkpoint::Info>(Checkpoint::Section::Info);
+            if (!info) {
+                std::cout << "Cannot restore: the checkpoint has no header record.\n";
+                continue;
+            }
+            std::string saved_scheduler(info->scheduler, strnlen(info->scheduler, sizeof(info->scheduler)));
+            if (saved_scheduler != active_scheduler || info->max_overall_mem != started_config->max_overall_mem || info->mem_per_frame != started_config->mem_per_frame
+                || info->huge_page_size != started_config->huge_page_size) {
+                std::cout << "Cannot restore: the checkpoint was taken with scheduler \"" << saved_scheduler << "\", max-overall-mem " << info->max_overall_mem
+                    << ", mem-per-frame " << info->mem_per_frame << " and huge-page-size " << info->huge_page_size << "; initialize with the same settings first.\n";
+                continue;
+            }
+
+            std::lock_guard<std::shared_mutex> submit_lock(submit_mtx);
+            if (active_scheduler == "fcfs") {
+                fcfs_scheduler.stop();
+            }
+            else {
+                rr_scheduler.stop();
+            }
+            auto now = std::chrono::steady_clock::now();
+            // Each step checks its sections before changing anything, so only a
+            // file that is internally inconsistent can fail part way through
+            bool restored = memory_manager->load(in) && ProcessTable::load(in, now);
+            if (restored) {
+                restored = active_scheduler == "fcfs" ? fcfs_scheduler.load(in, now) : rr_scheduler.load(in, now);
+            }
+            if (active_scheduler == "fcfs") {
+                fcfs_scheduler.start();
+            }
+            else {
+                rr_scheduler.start();
+            }
+            process_count = static_cast<int>(ProcessTable::size()); // Generated names carry on after the restored ones
+
+            if (restored) {
+                std::cout << "Restored " << info->rows << " processes from " << tokens[1] << " in "
+                    << std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - began).count() << " ms.\n";
+            }
+            else {
+                std::cout << "Cannot restore: " << tokens[1] << " is damaged; state may be partly restored, run initialize again.\n";
+            }
+        }
+        else if (tokens[0] == "metrics") {
+            MetricsWriter writer;
+            collect_metrics(writer);
+            std::cout << writer.str();
+        }
+        else if (tokens[0] == "reload") {
+            if (Config::Reload()) {
+                config = Config::Current();
+                rr_scheduler.SetQuantum(config->quantum_cycles);
+                rr_scheduler.SetAdaptiveQuantum(QuantumController::fromConfig(*config));
+                std::cout << "Config reloaded from \"config.txt\". num-cpu, scheduler, cpu-affinity and memory sizes apply on the next start; arrival settings on the next scheduler-test.\n";
+            }
+            else {
+                std::cout << "Reload failed, keeping the previous config.\n";
+            }
         }
         else if (command == "exit") {
             running = false;
         }
     }
 
-    if (scheduler_thread.joinable()) {
-        scheduler_thread.join();
-    }
+    generator.stop();
 
-    delete flat_allocator;
-    delete paging_allocator;
+    metrics_exporter.reset();
+    fcfs_scheduler.stop();
+    rr_scheduler.stop();
+    delete memory_manager;
 
     return 0;
 }
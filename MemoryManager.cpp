@@ -0,0 +1,67 @@
+#include "MemoryManager.h"
+#include "FlatMemoryAllocator.h"
+#include "PagingAllocator.h"
+#include "Metrics.h"
+
+MemoryManager* MemoryManager::create(const Config::ConfigParameters& config) {
+    if (config.max_overall_mem == config.mem_per_frame) {
+        return new FlatMemoryAllocator(config.max_overall_mem);
+    }
+    PagingOptions options;
+    options.huge_page_size = static_cast<int>(config.huge_page_size);
+    options.huge_threshold = static_cast<int>(config.huge_page_threshold);
+    options.working_set_window = config.working_set_window;
+    options.prefetch_pages = config.prefetch_pages;
+    // A background thread would make eviction timing nondeterministic
+    options.swapper_free_frames = config.clock_mode == "lockstep" ? 0 : config.swapper_free_frames;
+    return new PagingAllocator(static_cast<int>(config.max_overall_mem), static_cast<int>(config.mem_per_frame), options);
+}
+
+void MemoryManager::collectMetrics(MetricsWriter& out) const {
+    out.family("csopesy_memory_total_kb", "gauge", "Emulated physical memory.");
+    out.sample("csopesy_memory_total_kb", static_cast<double>(getTotalMemory()));
+    out.family("csopesy_memory_used_kb", "gauge", "Emulated physical memory in use.");
+    out.sample("csopesy_memory_used_kb", static_cast<double>(getUsedMemory()));
+    out.family("csopesy_memory_frames_in_use", "gauge", "Frames holding a page.");
+    out.sample("csopesy_memory_frames_in_use", static_cast<double>(getFramesInUse()));
+    out.family("csopesy_memory_page_faults_total", "counter", "Pages faulted in from the backing store.");
+    out.sample("csopesy_memory_page_faults_total", static_cast<double>(getPageFaults()));
+    out.family("csopesy_memory_pages_paged_out_total", "counter", "Pages written out to the backing store.");
+    out.sample("csopesy_memory_pages_paged_out_total", static_cast<double>(getPagesPagedOut()));
+    out.family("csopesy_memory_fragmentation_ratio", "gauge", "Allocator fragmentation, 0 to 1.");
+    out.sample("csopesy_memory_fragmentation_ratio", getFragmentation());
+
+    PagingStats paging = getPagingStats();
+    out.family("csopesy_memory_page_table_entries", "gauge", "Entries across all page tables.");
+    out.sample("csopesy_memory_page_table_entries", static_cast<double>(paging.page_table_entries));
+    out.family("csopesy_memory_huge_pages_in_use", "gauge", "Huge pages currently resident.");
+    out.sample("csopesy_memory_huge_pages_in_use", static_cast<double>(paging.huge_pages_used));
+    out.family("csopesy_memory_huge_page_faults_total", "counter", "Faults that brought in a whole huge page.");
+    out.sample("csopesy_memory_huge_page_faults_total", static_cast<double>(paging.huge_page_faults));
+    out.family("csopesy_memory_page_promotions_total", "counter", "Page tables switched to huge pages.");
+    out.sample("csopesy_memory_page_promotions_total", static_cast<double>(paging.promotions));
+    out.family("csopesy_memory_page_demotions_total", "counter", "Page tables split back into base pages.");
+    out.sample("csopesy_memory_page_demotions_total", static_cast<double>(paging.demotions));
+    out.family("csopesy_memory_shared_frames", "gauge", "Frames shared copy-on-write by forked processes.");
+    out.sample("csopesy_memory_shared_frames", static_cast<double>(paging.shared_frames));
+    out.family("csopesy_memory_forks_total", "counter", "Processes forked onto a parent's memory.");
+    out.sample("csopesy_memory_forks_total", static_cast<double>(paging.forks));
+    out.family("csopesy_memory_cow_copies_total", "counter", "Shared pages copied on their first write.");
+    out.sample("csopesy_memory_cow_copies_total", static_cast<double>(paging.cow_copies));
+    out.family("csopesy_memory_working_set_frames", "gauge", "Frames referenced within the working-set window, summed over processes.");
+    out.sample("csopesy_memory_working_set_frames", static_cast<double>(paging.working_set_frames));
+    out.family("csopesy_memory_prefetched_pages_total", "counter", "Pages read ahead after a sequential fault.");
+    out.sample("csopesy_memory_prefetched_pages_total", static_cast<double>(paging.prefetched_pages));
+    out.family("csopesy_memory_prefetch_hits_total", "counter", "Prefetched pages touched before being paged out.");
+    out.sample("csopesy_memory_prefetch_hits_total", static_cast<double>(paging.prefetch_hits));
+    out.family("csopesy_memory_working_set_evictions_total", "counter", "Pages paged out because they left every working set.");
+    out.sample("csopesy_memory_working_set_evictions_total", static_cast<double>(paging.working_set_evictions));
+    out.family("csopesy_memory_swapper_page_outs_total", "counter", "Pages paged out by the background swapper.");
+    out.sample("csopesy_memory_swapper_page_outs_total", static_cast<double>(paging.swapper_page_outs));
+    out.family("csopesy_memory_swapper_swap_outs_total", "counter", "Idle processes swapped out whole by the background swapper.");
+    out.sample("csopesy_memory_swapper_swap_outs_total", static_cast<double>(paging.swapper_swap_outs));
+    out.family("csopesy_memory_swapper_page_ins_total", "counter", "Pages brought in ahead of dispatch by the background swapper.");
+    out.sample("csopesy_memory_swapper_page_ins_total", static_cast<double>(paging.swapper_page_ins));
+    out.family("csopesy_memory_frame_waits_total", "counter", "Faults that waited for the background swapper to free a frame.");
+    out.sample("csopesy_memory_frame_waits_total", static_cast<double>(paging.frame_waits));
+}
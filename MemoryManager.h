@@ -0,0 +1,82 @@
+#pragma once
+#include <cstddef>
+#include "Checkpoint.h"
+#include "Config.h"
+
+class MetricsWriter;
+
+// Base class for the memory allocators. The schedulers admit, run and retire
+// processes through this interface without knowing which allocator is active.
+class MemoryManager {
+public:
+    virtual ~MemoryManager() = default;
+
+    // Reserves memory for a process at admission. Returns false if it does not fit.
+    virtual bool allocateProcess(int process_id, size_t size) = 0;
+    // Releases everything held by a process when it finishes.
+    virtual void deallocateProcess(int process_id) = 0;
+    // Called by a core before running a process; `offset` (KB) is the address
+    // it is about to touch. Paging allocators fault the page in if needed.
+    // `stored` reports that the process wrote its variables since the last
+    // call; they live at the start of its memory.
+    virtual void access(int /*process_id*/, size_t /*offset*/, bool /*stored*/) {}
+    // Called when a process is next in line for a core and will touch
+    // `offset` (KB) once dispatched. An allocator with a background swapper
+    // pages it in ahead of time; must not block.
+    virtual void prepareDispatch(int /*process_id*/, size_t /*offset*/) {}
+    // Maps a process that is about to be admitted onto the memory of a live
+    // one, copy-on-write, so its allocateProcess then reserves nothing.
+    // Returns false if the allocator cannot share memory, the parent holds
+    // none, or the child would not be admitted now.
+    virtual bool forkProcess(int /*parent_id*/, int /*child_id*/) { return false; }
+    // True when admission is by working set, which shrinks while a process
+    // sleeps, so a refused process is worth retrying when one blocks.
+    virtual bool admitsByWorkingSet() const { return false; }
+
+    virtual size_t getTotalMemory() const = 0;
+    virtual size_t getUsedMemory() const = 0;
+    virtual size_t getPageFaults() const { return 0; }
+    virtual size_t getPagesPagedOut() const { return 0; }
+    virtual size_t getFramesInUse() const { return 0; }
+    // Share of reserved memory that cannot serve requests: unusable free
+    // space for contiguous allocation, unused page tails for paging.
+    virtual double getFragmentation() const { return 0.0; }
+
+    // Translation overhead of a paging allocator; all zero otherwise
+    struct PagingStats {
+        size_t page_table_entries = 0;
+        size_t page_table_bytes = 0;
+        size_t huge_page_kb = 0;     // 0 when huge pages are off
+        size_t huge_pages_used = 0;
+        size_t huge_page_faults = 0;
+        size_t promotions = 0;
+        size_t demotions = 0;
+        size_t shared_frames = 0;    // Mapped by more than one process
+        size_t forks = 0;
+        size_t cow_copies = 0;
+        size_t working_set_frames = 0;
+        size_t prefetched_pages = 0;
+        size_t prefetch_hits = 0;
+        size_t working_set_evictions = 0;
+        size_t swapper_page_outs = 0;  // Paged out by the background swapper
+        size_t swapper_swap_outs = 0;  // Whole processes it swapped out
+        size_t swapper_page_ins = 0;   // Pages it brought in ahead of dispatch
+        size_t frame_waits = 0;        // Faults that waited for it to free a frame
+    };
+    virtual PagingStats getPagingStats() const { return {}; }
+
+    // Appends memory families to a Prometheus exposition. Reads only atomics.
+    void collectMetrics(MetricsWriter& out) const;
+
+    virtual void printMemoryState() = 0;
+
+    // Checkpoint support, with no core touching memory. load replaces the
+    // whole allocator state and fails without changes if the sections were
+    // written by another allocator or for another memory size.
+    virtual void save(Checkpoint::Writer& out) const = 0;
+    virtual bool load(const Checkpoint::Reader& in) = 0;
+
+    // Flat allocation when one frame spans all of memory, paging otherwise,
+    // with the paging options the config enables.
+    static MemoryManager* create(const Config::ConfigParameters& config);
+};
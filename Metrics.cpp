@@ -0,0 +1,214 @@
+#include "Metrics.h"
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <utility>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "ws2_32.lib")
+using socket_t = SOCKET;
+#define CLOSE_SOCKET closesocket
+#define SEND_FLAGS 0
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+using socket_t = int;
+#define CLOSE_SOCKET close
+#ifdef MSG_NOSIGNAL
+#define SEND_FLAGS MSG_NOSIGNAL // A scraper that hangs up early must not raise SIGPIPE
+#else
+#define SEND_FLAGS 0
+#endif
+#endif
+
+void MetricsWriter::family(const char* name, const char* type, const char* help) {
+    buffer.append("# HELP ").append(name).append(" ").append(help).append("\n");
+    buffer.append("# TYPE ").append(name).append(" ").append(type).append("\n");
+}
+
+void MetricsWriter::appendValue(double value) {
+    char digits[32];
+    auto result = std::to_chars(digits, digits + sizeof(digits), value);
+    buffer.append(digits, result.ptr);
+    buffer.append("\n");
+}
+
+void MetricsWriter::sample(const char* name, double value) {
+    buffer.append(name).append(" ");
+    appendValue(value);
+}
+
+void MetricsWriter::sample(const char* name, const char* label, long long label_value, double value) {
+    char digits[24];
+    auto result = std::to_chars(digits, digits + sizeof(digits), label_value);
+    buffer.append(name).append("{").append(label).append("=\"").append(digits, result.ptr).append("\"} ");
+    appendValue(value);
+}
+
+void MetricsWriter::sample(const char* name, const char* label, const char* label_value, double value) {
+    buffer.append(name).append("{").append(label).append("=\"").append(label_value).append("\"} ");
+    appendValue(value);
+}
+
+void appendCoreMetrics(MetricsWriter& out, const std::vector<std::unique_ptr<CoreStats>>& cores, double uptime_seconds) {
+    out.family("csopesy_core_utilization_ratio", "gauge", "Fraction of wall time the core spent running processes since start.");
+    for (size_t i = 0; i < cores.size(); ++i) {
+        if (!cores[i]) continue;
+        double busy = static_cast<double>(cores[i]->busy_nanoseconds.load(std::memory_order_relaxed)) / 1e9;
+        out.sample("csopesy_core_utilization_ratio", "core", static_cast<long long>(i), uptime_seconds > 0 ? std::min(busy / uptime_seconds, 1.0) : 0.0);
+    }
+    out.family("csopesy_core_busy_cycles_total", "counter", "Cycles spent executing process instructions or SLEEP.");
+    for (size_t i = 0; i < cores.size(); ++i) {
+        if (!cores[i]) continue;
+        out.sample("csopesy_core_busy_cycles_total", "core", static_cast<long long>(i), static_cast<double>(cores[i]->busy_cycles.load(std::memory_order_relaxed)));
+    }
+    out.family("csopesy_core_context_switches_total", "counter", "Processes dispatched onto the core.");
+    for (size_t i = 0; i < cores.size(); ++i) {
+        if (!cores[i]) continue;
+        out.sample("csopesy_core_context_switches_total", "core", static_cast<long long>(i), static_cast<double>(cores[i]->dispatches.load(std::memory_order_relaxed)));
+    }
+}
+
+namespace {
+
+void appendLatencySummary(MetricsWriter& out, const std::string& name, const char* help, const LatencyHistogram& histogram) {
+    static constexpr std::pair<double, const char*> quantiles[] = {
+        { 50.0, "0.5" }, { 90.0, "0.9" }, { 99.0, "0.99" }, { 99.9, "0.999" },
+    };
+    out.family(name.c_str(), "summary", help);
+    for (const auto& q : quantiles) {
+        out.sample(name.c_str(), "quantile", q.second, static_cast<double>(histogram.percentile(q.first)) / 1e9);
+    }
+    out.sample((name + "_sum").c_str(), static_cast<double>(histogram.sum()) / 1e9);
+    out.sample((name + "_count").c_str(), static_cast<double>(histogram.count()));
+}
+
+}
+
+void appendLatencyMetrics(MetricsWriter& out, const SchedulerLatency& latency) {
+    appendLatencySummary(out, "csopesy_waiting_seconds", "Time finished processes spent off a core between arrival and completion.", latency.waiting);
+    appendLatencySummary(out, "csopesy_response_seconds", "Time from arrival to first dispatch.", latency.response);
+    appendLatencySummary(out, "csopesy_turnaround_seconds", "Time from arrival to completion.", latency.turnaround);
+}
+
+MetricsExporter::MetricsExporter(Source source) : source(std::move(source)) {}
+
+MetricsExporter::~MetricsExporter() {
+    stop();
+}
+
+std::string MetricsExporter::render() {
+    MetricsWriter writer;
+    source(writer);
+    return writer.str();
+}
+
+bool MetricsExporter::serveHttp(int port) {
+#ifdef _WIN32
+    WSADATA wsa;
+    if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0) return false;
+#endif
+    socket_t fd = socket(AF_INET, SOCK_STREAM, 0);
+#ifdef _WIN32
+    if (fd == INVALID_SOCKET) return false;
+#else
+    if (fd < 0) return false;
+#endif
+
+    int reuse = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&reuse), sizeof(reuse));
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<unsigned short>(port));
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || listen(fd, 8) != 0) {
+        CLOSE_SOCKET(fd);
+        return false;
+    }
+
+    listen_socket = static_cast<long long>(fd);
+    http_thread = std::thread(&MetricsExporter::httpLoop, this);
+    return true;
+}
+
+void MetricsExporter::httpLoop() {
+    socket_t fd = static_cast<socket_t>(listen_socket);
+    while (running) {
+        // Wake up regularly so stop() does not wait on a blocked accept
+        fd_set ready;
+        FD_ZERO(&ready);
+        FD_SET(fd, &ready);
+        timeval timeout{ 0, 200000 };
+        if (select(static_cast<int>(fd) + 1, &ready, nullptr, nullptr, &timeout) <= 0) continue;
+
+        socket_t client = accept(fd, nullptr, nullptr);
+#ifdef _WIN32
+        if (client == INVALID_SOCKET) continue;
+#else
+        if (client < 0) continue;
+#endif
+        // Every request path gets the metrics; the request itself is not inspected
+        char request[1024];
+        if (recv(client, request, sizeof(request), 0) <= 0) {
+            CLOSE_SOCKET(client); // Closed or reset before sending a request
+            continue;
+        }
+
+        std::string body = render();
+        std::string response = "HTTP/1.1 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: "
+            + std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n" + body;
+        size_t sent = 0;
+        while (sent < response.size()) {
+            int n = send(client, response.data() + sent, static_cast<int>(response.size() - sent), SEND_FLAGS);
+            if (n <= 0) break;
+            sent += static_cast<size_t>(n);
+        }
+        CLOSE_SOCKET(client);
+    }
+    CLOSE_SOCKET(fd);
+#ifdef _WIN32
+    WSACleanup();
+#endif
+}
+
+void MetricsExporter::writeFile(const std::string& path, double interval_seconds) {
+    file_thread = std::thread(&MetricsExporter::fileLoop, this, path, interval_seconds);
+}
+
+void MetricsExporter::fileLoop(std::string path, double interval_seconds) {
+    auto interval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(std::max(interval_seconds, 0.1)));
+    auto next = std::chrono::steady_clock::now();
+    while (running) {
+        // Write a temporary file and rename it so scrapers never see a partial file
+        std::string temp = path + ".tmp";
+        {
+            std::ofstream out(temp, std::ios::trunc);
+            out << render();
+        }
+#ifdef _WIN32
+        std::remove(path.c_str()); // rename does not replace on Windows
+#endif
+        std::rename(temp.c_str(), path.c_str());
+
+        next += interval;
+        while (running && std::chrono::steady_clock::now() < next) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+    }
+}
+
+void MetricsExporter::stop() {
+    running = false;
+    if (http_thread.joinable()) http_thread.join();
+    if (file_thread.joinable()) file_thread.join();
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include "CoreStats.h"
+#include "LatencyHistogram.h"
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Builds a Prometheus text-format (version 0.0.4) exposition.
+class MetricsWriter {
+public:
+    // Starts a metric family; emit its samples right after.
+    void family(const char* name, const char* type, const char* help);
+    void sample(const char* name, double value);
+    void sample(const char* name, const char* label, long long label_value, double value);
+    void sample(const char* name, const char* label, const char* label_value, double value);
+
+    void clear() { buffer.clear(); }
+    const std::string& str() const { return buffer; }
+
+private:
+    void appendValue(double value);
+    std::string buffer;
+};
+
+// Per-core families shared by the schedulers: utilization, busy cycles and
+// context switches, read from the lock-free CoreStats counters.
+void appendCoreMetrics(MetricsWriter& out, const std::vector<std::unique_ptr<CoreStats>>& cores, double uptime_seconds);
+
+// Waiting, response and turnaround time as summaries with p50/p90/p99/p99.9
+// quantiles, read from the lock-free histograms.
+void appendLatencyMetrics(MetricsWriter& out, const SchedulerLatency& latency);
+
+// Serves metrics on a local HTTP listener and/or writes them to a file at a
+// fixed interval. Each scrape calls the source on the exporter's own thread,
+// so the source must only read atomics or take short locks.
+class MetricsExporter {
+public:
+    using Source = std::function<void(MetricsWriter&)>;
+
+    explicit MetricsExporter(Source source);
+    ~MetricsExporter();
+
+    bool serveHttp(int port);   // Binds 127.0.0.1:port; false if the port is unavailable
+    void writeFile(const std::string& path, double interval_seconds);
+    void stop();
+
+    std::string render();
+
+private:
+    void httpLoop();
+    void fileLoop(std::string path, double interval_seconds);
+
+    Source source;
+    std::atomic<bool> running{ true };
+    long long listen_socket = -1;
+    std::thread http_thread;
+    std::thread file_thread;
+};
@@ -1,114 +1,781 @@
 #include "PagingAllocator.h"
+#include "Tracer.h"
 #include <algorithm>
-#include <queue>
+#include <cstdint>
+
+namespace {
+
+struct PagingInfo {
+    int32_t total_frames;
+    int32_t frame_size;
+    uint64_t pages_paged_in;
+    uint64_t pages_paged_out;
+    int32_t huge_frames;
+    uint32_t pad;
+    uint64_t huge_page_faults;
+    uint64_t promotions;
+    uint64_t demotions;
+    uint64_t forks;
+    uint64_t cow_copies;
+    uint64_t prefetched_pages;
+    uint64_t prefetch_hits;
+    uint64_t working_set_evictions;
+    uint64_t swapper_page_outs;
+    uint64_t swapper_swap_outs;
+    uint64_t swapper_page_ins;
+    uint64_t frame_waits;
+};
+
+// One per process; its entries follow the previous table's in PagingEntries
+struct PageTableRecord {
+    int32_t process_id;
+    int32_t size;  // Requested KB
+    uint32_t pages;
+    uint32_t huge;  // Every entry is a huge page
+};
+
+struct PageEntryRecord {
+    int32_t frame_number;
+    uint32_t flags; // ENTRY_* bits, and the reference history in bits 8-15
+};
+
+constexpr uint32_t ENTRY_VALID = 0x1;
+constexpr uint32_t ENTRY_REFERENCED = 0x2;
+constexpr uint32_t ENTRY_PREFETCHED = 0x4;
+
+}
 
 // Constructor
-PagingAllocator::PagingAllocator(int total_memory, int frame_size)
-    : frame_size(frame_size), total_frames(total_memory / frame_size) {
+PagingAllocator::PagingAllocator(int total_memory, int frame_size, const PagingOptions& options)
+    : frame_size(frame_size), total_frames(total_memory / frame_size),
+      huge_frames(options.huge_page_size > frame_size ? options.huge_page_size / frame_size : 0),
+      huge_threshold(options.huge_threshold > 0 ? options.huge_threshold : options.huge_page_size),
+      working_set_window(std::min(options.working_set_window, 8)),
+      prefetch_pages(options.prefetch_pages),
+      swapper_free_frames(std::clamp(options.swapper_free_frames, 0, total_frames / 4)) {
     frame_usage.resize(total_frames, false); // All frames initially free
+    frame_refs.resize(total_frames, 0);
+    frame_owners.resize(total_frames, { -1, 0 });
+    if (swapper_free_frames > 0) {
+        swapper = std::thread(&PagingAllocator::swapperLoop, this);
+    }
+}
+
+PagingAllocator::~PagingAllocator() {
+    if (!swapper.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lock(swap_mtx);
+        swapper_stopping = true;
+    }
+    swap_cv.notify_one();
+    swapper.join();
+}
+
+// Caller holds mtx. Adds a mapping to each of `count` frames from `first`,
+// recording page `page` of `process_id` as the frames' owner when given.
+void PagingAllocator::claimFrames(int first, int count, int process_id, int page) {
+    for (int frame = first; frame < first + count; ++frame) {
+        if (process_id >= 0) {
+            frame_owners[frame] = { process_id, page };
+        }
+        if (frame_refs[frame]++ == 0) {
+            frame_usage[frame] = true;
+            ++used_frames;
+        }
+        else if (frame_refs[frame] == 2) {
+            ++shared_frames;
+        }
+    }
+    if (freeFrames() < swapper_free_frames) {
+        wakeSwapper();
+    }
+}
+
+// Caller holds mtx. Drops a mapping from each frame; the last one frees it.
+void PagingAllocator::releaseFrames(int first, int count) {
+    for (int frame = first; frame < first + count; ++frame) {
+        if (--frame_refs[frame] == 0) {
+            frame_usage[frame] = false;
+            --used_frames;
+        }
+        else if (frame_refs[frame] == 1) {
+            --shared_frames;
+        }
+    }
+}
+
+// Finds a free frame if memory is full. With working sets tracked, a page
+// that has left every working set goes first; otherwise the oldest other
+// process is swapped out. Returns -1 if nothing can be freed. With the
+// swapper running, eviction is left to it and -1 means no frame is free yet.
+int PagingAllocator::findFreeFrame(int requesting_process_id) {
+    auto it = std::find(frame_usage.begin(), frame_usage.end(), false);
+    if (swapper_free_frames > 0) {
+        return it == frame_usage.end() ? -1 : static_cast<int>(it - frame_usage.begin());
+    }
+    while (it == frame_usage.end()) {
+        bool evicted = working_set_window > 0 && evictColdPageLocked();
+        if (!evicted && !swapOutOldestLocked(requesting_process_id)) {
+            return -1;
+        }
+        it = std::find(frame_usage.begin(), frame_usage.end(), false);
+    }
+    return static_cast<int>(it - frame_usage.begin());
+}
+
+// Caller holds mtx. Sweeps a clock hand over the frames and pages out the
+// first private page that is outside its process's working set. Returns
+// false after a full turn if every resident page is in a working set or
+// shared. An owner record is checked against its page table before use,
+// since a frame that was shared may have kept the owner of another mapping.
+bool PagingAllocator::evictColdPageLocked() {
+    for (int scanned = 0; scanned < total_frames; ++scanned) {
+        int frame = clock_hand;
+        clock_hand = (clock_hand + 1) % total_frames;
+        if (frame_refs[frame] != 1) continue;
+
+        const FrameOwner& owner = frame_owners[frame];
+        auto table = page_tables.find(owner.process_id);
+        if (table == page_tables.end() || owner.page >= static_cast<int>(table->second.size())) continue;
+        const PageTableEntry& entry = table->second[owner.page];
+        bool maps_frame = entry.valid && entry.frame_number <= frame && frame < entry.frame_number + framesOf(entry);
+        if (!maps_frame || inWorkingSet(entry)) continue;
+
+        pageOutLocked(owner.process_id, owner.page);
+        ++working_set_evictions;
+        return true;
+    }
+    return false;
+}
+
+// Caller holds mtx. Shifts every page's referenced bit into its history and
+// recounts the working sets: the frames of pages referenced within the last
+// working_set_window samples.
+void PagingAllocator::sampleWorkingSetsLocked() {
+    accesses_since_sample = 0;
+    size_t total = 0;
+    for (auto& [process_id, pages] : page_tables) {
+        size_t frames = 0;
+        for (PageTableEntry& entry : pages) {
+            entry.history = static_cast<uint8_t>((entry.history << 1) | (entry.referenced ? 1 : 0));
+            entry.referenced = false;
+            if (inWorkingSet(entry)) frames += static_cast<size_t>(framesOf(entry));
+        }
+        working_sets[process_id] = frames;
+        total += frames;
+    }
+    working_set_frames = total;
+}
+
+// Caller holds mtx.
+void PagingAllocator::referenceLocked(PageTableEntry& entry) {
+    if (!entry.valid) return;
+    entry.referenced = true;
+    if (entry.prefetched) {
+        entry.prefetched = false;
+        ++prefetch_hits;
+    }
+}
+
+// Caller holds mtx. Reads up to prefetch_pages pages from `first_page` on into
+// free frames. Prefetching never evicts anything to make room.
+void PagingAllocator::prefetchLocked(int process_id, int first_page) {
+    std::vector<PageTableEntry>& pages = page_tables[process_id];
+    int last_page = std::min(first_page + prefetch_pages, static_cast<int>(pages.size()));
+    for (int page = first_page; page < last_page; ++page) {
+        PageTableEntry& entry = pages[page];
+        if (entry.valid) continue;
+        auto free_frame = std::find(frame_usage.begin(), frame_usage.end(), false);
+        if (free_frame == frame_usage.end()) break;
+
+        int frame_index = static_cast<int>(free_frame - frame_usage.begin());
+        claimFrames(frame_index, 1, process_id, page);
+        entry.frame_number = frame_index;
+        entry.valid = true;
+        entry.prefetched = true; // Outside the working set until touched, so evicted first if unused
+        ++prefetched_pages;
+        last_faults[process_id] = page;
+        TRACE_EVENT(Tracer::Event::PageIn, process_id, page);
+    }
+}
+
+// First free run of huge_frames frames starting on a multiple of huge_frames,
+// or -1. Never swaps anything out; callers fall back to base pages instead.
+int PagingAllocator::findFreeHugeBlock() const {
+    for (int start = 0; start + huge_frames <= total_frames; start += huge_frames) {
+        auto block = frame_usage.begin() + start;
+        if (std::find(block, block + huge_frames, true) == block + huge_frames) {
+            return start;
+        }
+    }
+    return -1;
 }
 
 // Allocates memory for a process
 bool PagingAllocator::allocate(int process_id, int size) {
+    std::lock_guard<std::mutex> lock(mtx);
+    if (page_tables.count(process_id)) return true; // Already mapped by forkProcess
     int num_pages = (size + frame_size - 1) / frame_size; // Round up to nearest page
-    std::vector<PageTableEntry> page_table;
+    if (num_pages > total_frames) return false;
 
+    // With working sets tracked, a process is admitted only if it fits next
+    // to the working sets already resident; its declared size stands in for
+    // its own working set until it has been sampled.
+    if (working_set_window > 0) {
+        bool fits = resident_processes.empty() || working_set_frames + static_cast<size_t>(num_pages) <= static_cast<size_t>(total_frames);
+        if (!fits) return false;
+        working_sets[process_id] = static_cast<size_t>(num_pages);
+        working_set_frames += static_cast<size_t>(num_pages);
+    }
+
+    // Large processes take huge pages while aligned runs are free
+    if (huge_frames > 0 && size >= huge_threshold && allocateHugeLocked(process_id, size)) {
+        return true;
+    }
+
+    std::vector<PageTableEntry> page_table;
     for (int i = 0; i < num_pages; ++i) {
-        // Find a free frame
-        auto it = std::find(frame_usage.begin(), frame_usage.end(), false);
-        if (it == frame_usage.end()) {
-            // No free frame found, swap out the oldest process
-            swapOutOldest();
-            it = std::find(frame_usage.begin(), frame_usage.end(), false);
-            if (it == frame_usage.end()) {
-                // Still no free frame, fail allocation
-                return false;
+        if (working_set_window > 0 || swapper_free_frames > 0) {
+            // Pages that do not fit without evicting someone are faulted in on
+            // first use, so admission never waits for the swapper
+            auto free_frame = std::find(frame_usage.begin(), frame_usage.end(), false);
+            if (free_frame == frame_usage.end()) {
+                page_table.push_back({ -1, false, false });
+                continue;
             }
+            int frame_index = static_cast<int>(free_frame - frame_usage.begin());
+            claimFrames(frame_index, 1, process_id, i);
+            page_table.push_back({ frame_index, true, false, true });
+            continue;
         }
 
-        int frame_index = it - frame_usage.begin();
-        frame_usage[frame_index] = true;
+        int frame_index = findFreeFrame(process_id);
+        if (frame_index == -1) {
+            // Still no free frame, roll back and fail allocation
+            for (const auto& entry : page_table) {
+                releaseFrames(entry.frame_number, 1);
+            }
+            return false;
+        }
+
+        claimFrames(frame_index, 1, process_id, i);
 
         // Add page table entry
-        page_table.push_back({ frame_index, true });
+        page_table.push_back({ frame_index, true, false });
     }
 
     page_tables[process_id] = page_table; // Save the page table for the process
+    resident_processes.push_back(process_id);
+    requested_kb += static_cast<size_t>(size);
+    reserved_kb += static_cast<size_t>(num_pages) * frame_size;
+    page_table_entries += static_cast<size_t>(num_pages);
+    process_sizes[process_id] = size;
     return true;
 }
 
+// Caller holds mtx. Maps the whole process with huge pages if enough aligned
+// runs are free. Returns false with nothing changed otherwise.
+bool PagingAllocator::allocateHugeLocked(int process_id, int size) {
+    int huge_kb = huge_frames * frame_size;
+    int num_pages = (size + huge_kb - 1) / huge_kb;
+
+    std::vector<PageTableEntry> page_table;
+    for (int i = 0; i < num_pages; ++i) {
+        int block = findFreeHugeBlock();
+        if (block == -1) {
+            for (const auto& entry : page_table) {
+                releaseFrames(entry.frame_number, huge_frames);
+            }
+            return false;
+        }
+        claimFrames(block, huge_frames, process_id, i);
+        page_table.push_back({ block, true, true, true });
+    }
+
+    huge_pages_used += static_cast<size_t>(num_pages);
+    page_tables[process_id] = std::move(page_table);
+    resident_processes.push_back(process_id);
+    requested_kb += static_cast<size_t>(size);
+    reserved_kb += static_cast<size_t>(num_pages) * huge_kb;
+    page_table_entries += static_cast<size_t>(num_pages);
+    process_sizes[process_id] = size;
+    return true;
+}
+
+// Caller holds mtx. A process large enough for huge pages that was mapped
+// with base pages is promoted once none of its pages are resident, so no
+// page has to move, and only if an aligned run is free for the fault at hand.
+bool PagingAllocator::promotableLocked(int process_id, const std::vector<PageTableEntry>& table) const {
+    if (huge_frames == 0 || table.front().huge) return false;
+    auto size = process_sizes.find(process_id);
+    if (size == process_sizes.end() || size->second < huge_threshold) return false;
+    bool resident = std::any_of(table.begin(), table.end(), [](const PageTableEntry& entry) { return entry.valid; });
+    return !resident && findFreeHugeBlock() != -1;
+}
+
+// Caller holds mtx and has checked promotableLocked.
+void PagingAllocator::promoteLocked(int process_id) {
+    std::vector<PageTableEntry>& table = page_tables[process_id];
+    int huge_kb = huge_frames * frame_size;
+    size_t num_pages = static_cast<size_t>((process_sizes[process_id] + huge_kb - 1) / huge_kb);
+
+    reserved_kb += num_pages * huge_kb - table.size() * frame_size;
+    page_table_entries -= table.size() - num_pages;
+    table.assign(num_pages, { -1, false, true });
+    ++promotions;
+}
+
+// Caller holds mtx. Splits every huge page of a process into base pages.
+// Resident huge pages stay in place as runs of base pages, except for the
+// frames past the process's last base page, which are freed.
+void PagingAllocator::demoteLocked(int process_id) {
+    std::vector<PageTableEntry>& table = page_tables[process_id];
+    size_t num_pages = static_cast<size_t>((process_sizes[process_id] + frame_size - 1) / frame_size);
+
+    std::vector<PageTableEntry> split;
+    split.reserve(num_pages);
+    for (const PageTableEntry& entry : table) {
+        for (int i = 0; i < huge_frames; ++i) {
+            if (split.size() < num_pages) {
+                if (entry.valid) {
+                    frame_owners[entry.frame_number + i] = { process_id, static_cast<int>(split.size()) };
+                }
+                split.push_back({ entry.frame_number + i, entry.valid, false, entry.referenced, false, entry.history });
+            }
+            else if (entry.valid) {
+                releaseFrames(entry.frame_number + i, 1);
+            }
+        }
+        if (entry.valid) --huge_pages_used;
+    }
+
+    reserved_kb -= (table.size() * huge_frames - split.size()) * frame_size;
+    page_table_entries += split.size() - table.size();
+    table.swap(split);
+    ++demotions;
+}
+
 // Deallocates memory for a process
 void PagingAllocator::deallocate(int process_id) {
-    for (const auto& entry : page_tables[process_id]) {
+    std::lock_guard<std::mutex> lock(mtx);
+    deallocateLocked(process_id);
+}
+
+void PagingAllocator::deallocateLocked(int process_id) {
+    auto table = page_tables.find(process_id);
+    if (table == page_tables.end()) return;
+
+    size_t reserved_frames = 0;
+    for (const auto& entry : table->second) {
+        int frames = framesOf(entry);
+        reserved_frames += static_cast<size_t>(frames);
         if (entry.valid) {
-            frame_usage[entry.frame_number] = false; // Mark frame as free
+            releaseFrames(entry.frame_number, frames); // Frees them unless another process shares them
+            if (entry.huge) --huge_pages_used;
         }
     }
-    page_tables.erase(process_id); // Remove the process's page table
+    requested_kb -= static_cast<size_t>(process_sizes[process_id]);
+    reserved_kb -= reserved_frames * frame_size;
+    page_table_entries -= table->second.size();
+    process_sizes.erase(process_id);
+    auto working_set = working_sets.find(process_id);
+    if (working_set != working_sets.end()) {
+        working_set_frames -= working_set->second;
+        working_sets.erase(working_set);
+    }
+    last_faults.erase(process_id);
+    last_access.erase(process_id);
+    page_tables.erase(table); // Remove the process's page table
+    resident_processes.erase(std::remove(resident_processes.begin(), resident_processes.end(), process_id), resident_processes.end());
+    backing_store.erase(std::remove(backing_store.begin(), backing_store.end(), process_id), backing_store.end());
 }
 
 // Loads a page into memory
 void PagingAllocator::pageIn(int process_id, int page_number) {
-    if (page_tables.find(process_id) == page_tables.end()) return;
-    if (page_number >= page_tables[process_id].size()) return;
-
-    auto& entry = page_tables[process_id][page_number];
-    if (!entry.valid) {
-        // Find a free frame
-        auto it = std::find(frame_usage.begin(), frame_usage.end(), false);
-        if (it == frame_usage.end()) {
-            // No free frame, swap out the oldest process
-            swapOutOldest();
-            it = std::find(frame_usage.begin(), frame_usage.end(), false);
-            if (it == frame_usage.end()) {
-                // Still no free frame, cannot page in
+    std::lock_guard<std::mutex> lock(mtx);
+    pageInLocked(process_id, page_number);
+}
+
+// Returns false only if no frame could be found for the page.
+bool PagingAllocator::pageInLocked(int process_id, int page_number) {
+    auto table = page_tables.find(process_id);
+    if (table == page_tables.end()) return true;
+    if (page_number < 0 || page_number >= static_cast<int>(table->second.size())) return true;
+
+    if (!table->second[page_number].valid) {
+        bool huge = table->second[page_number].huge;
+        int frame_index = huge ? findFreeHugeBlock() : findFreeFrame(process_id);
+        if (frame_index == -1) {
+            // Still no free frame, cannot page in; with the swapper the caller waits for one
+            if (swapper_free_frames == 0) {
                 std::cerr << "No free frame available for paging in process " << process_id << "\n";
-                return;
             }
+            return false;
         }
 
-        int frame_index = it - frame_usage.begin();
-        frame_usage[frame_index] = true;
+        auto& entry = page_tables[process_id][page_number];
+        int frames = framesOf(entry);
+        claimFrames(frame_index, frames, process_id, page_number);
         entry.frame_number = frame_index;
         entry.valid = true;
         ++pages_paged_in;
+        if (huge) {
+            ++huge_pages_used;
+            ++huge_page_faults;
+        }
+        TRACE_EVENT(Tracer::Event::PageIn, process_id, page_number);
+
+        // A fault right after the last page faulted or read ahead looks like a
+        // stream, so the pages after it are read ahead too
+        if (!huge && prefetch_pages > 0) {
+            auto last_fault = last_faults.find(process_id);
+            bool sequential = last_fault != last_faults.end() && last_fault->second + 1 == page_number;
+            last_faults[process_id] = page_number;
+            if (sequential) {
+                prefetchLocked(process_id, page_number + 1);
+            }
+        }
+
+        // A swapped-out process becomes resident again on its first fault
+        auto swapped = std::find(backing_store.begin(), backing_store.end(), process_id);
+        if (swapped != backing_store.end()) {
+            backing_store.erase(swapped);
+            resident_processes.push_back(process_id);
+        }
     }
+    return true;
 }
 
 // Removes a page from memory
 void PagingAllocator::pageOut(int process_id, int page_number) {
-    if (page_tables.find(process_id) == page_tables.end()) return;
-    if (page_number >= page_tables[process_id].size()) return;
+    std::lock_guard<std::mutex> lock(mtx);
+    pageOutLocked(process_id, page_number);
+}
+
+void PagingAllocator::pageOutLocked(int process_id, int page_number) {
+    auto table = page_tables.find(process_id);
+    if (table == page_tables.end()) return;
+    if (page_number < 0 || page_number >= static_cast<int>(table->second.size())) return;
 
-    auto& entry = page_tables[process_id][page_number];
+    auto& entry = table->second[page_number];
     if (entry.valid) {
-        frame_usage[entry.frame_number] = false;
+        int frames = framesOf(entry);
+        releaseFrames(entry.frame_number, frames);
+        if (entry.huge) --huge_pages_used;
         entry.valid = false;
         ++pages_paged_out;
+        TRACE_EVENT(Tracer::Event::PageOut, process_id, page_number);
     }
 }
 
+// Maps the child onto the parent's frames: the child gets a copy of the
+// parent's page table and each resident frame one more reference, so forking
+// costs a page table and no frames until either side writes. With working
+// sets tracked the child is admitted by the parent's sampled working set, as
+// allocate admits any other process; if that does not fit the fork fails and
+// the child waits for admission like a new process.
+bool PagingAllocator::forkProcess(int parent_id, int child_id) {
+    std::lock_guard<std::mutex> lock(mtx);
+    auto parent = page_tables.find(parent_id);
+    if (parent == page_tables.end() || page_tables.count(child_id)) return false;
+
+    size_t working_set = 0;
+    if (working_set_window > 0) {
+        auto sampled = working_sets.find(parent_id);
+        working_set = sampled != working_sets.end() ? sampled->second : parent->second.size();
+        bool fits = resident_processes.empty() || working_set_frames + working_set <= static_cast<size_t>(total_frames);
+        if (!fits) return false;
+        working_sets[child_id] = working_set;
+        working_set_frames += working_set;
+    }
+
+    std::vector<PageTableEntry> table = parent->second;
+    size_t reserved_frames = 0;
+    bool resident = false;
+    for (const PageTableEntry& entry : table) {
+        reserved_frames += static_cast<size_t>(framesOf(entry));
+        if (!entry.valid) continue;
+        claimFrames(entry.frame_number, framesOf(entry));
+        if (entry.huge) ++huge_pages_used;
+        resident = true;
+    }
+
+    int size = process_sizes[parent_id];
+    requested_kb += static_cast<size_t>(size);
+    reserved_kb += reserved_frames * frame_size;
+    page_table_entries += table.size();
+    process_sizes[child_id] = size;
+    page_tables.emplace(child_id, std::move(table));
+    if (resident) {
+        resident_processes.push_back(child_id);
+    }
+    else {
+        backing_store.push_back(child_id);
+    }
+    ++forks;
+    return true;
+}
+
+// Touches the page holding `offset` (KB), and gives the process its own copy
+// of its first page, where its variables live, if it stored to them.
+void PagingAllocator::access(int process_id, size_t offset, bool stored) {
+    std::unique_lock<std::mutex> lock(mtx);
+    if (swapper_free_frames > 0) {
+        last_access[process_id] = ++access_clock;
+    }
+    // With the swapper, a fault that finds no free frame waits for its next
+    // pass while other cores go on faulting into whatever frames are free,
+    // and gives up once it has nothing left to evict. Without it the fault
+    // has already evicted what it could, so one attempt is all there is.
+    while (!touchLocked(process_id, offset) && swapper_free_frames > 0) {
+        ++frame_waits;
+        uint64_t pass = swapper_passes;
+        wakeSwapper();
+        frames_freed.wait(lock, [&] { return swapper_passes != pass; });
+        if (swapper_stalled && freeFrames() == 0) {
+            std::cerr << "No free frame available for paging in process " << process_id << "\n";
+            break;
+        }
+    }
+    if (stored) {
+        copyOnWriteLocked(process_id, 0);
+    }
+    if (working_set_window > 0 && ++accesses_since_sample >= std::max<size_t>(resident_processes.size(), 1)) {
+        sampleWorkingSetsLocked();
+    }
+}
+
+// Caller holds mtx. Gives the process a private copy of the page holding
+// `offset` if its frame is shared. A shared huge page is split first so that
+// only the base page written is copied. Without a free frame the page stays
+// shared and the copy is retried on the next store.
+void PagingAllocator::copyOnWriteLocked(int process_id, size_t offset) {
+    touchLocked(process_id, offset);
+    auto table = page_tables.find(process_id);
+    if (table == page_tables.end() || table->second.empty()) return;
+
+    std::vector<PageTableEntry>& pages = table->second;
+    size_t page = offset / frame_size;
+    if (pages.front().huge) {
+        size_t huge_page = std::min(page / huge_frames, pages.size() - 1);
+        if (!pages[huge_page].valid || frame_refs[pages[huge_page].frame_number] < 2) return;
+        demoteLocked(process_id);
+    }
+
+    int page_number = static_cast<int>(std::min(page, pages.size() - 1));
+    PageTableEntry& entry = pages[page_number];
+    if (!entry.valid || frame_refs[entry.frame_number] < 2) return;
+    int frame_index = findFreeFrame(process_id);
+    // Swapping out to make room may have dropped the other references
+    if (frame_index == -1 || frame_refs[entry.frame_number] < 2) return;
+
+    releaseFrames(entry.frame_number, 1);
+    claimFrames(frame_index, 1, process_id, page_number);
+    entry.frame_number = frame_index;
+    ++cow_copies;
+}
+
+// Caller holds mtx. Faults in the page holding `offset` (KB) if it was
+// swapped out. A huge page that cannot be faulted in for want of an aligned
+// run demotes its process, which then faults base pages like any other.
+// Returns false only if no frame was free for the page.
+bool PagingAllocator::touchLocked(int process_id, size_t offset) {
+    auto table = page_tables.find(process_id);
+    if (table == page_tables.end() || table->second.empty()) return true;
+
+    std::vector<PageTableEntry>& pages = table->second;
+    size_t page = offset / frame_size; // In base pages
+    if (pages.front().huge) {
+        size_t huge_page = std::min(page / huge_frames, pages.size() - 1);
+        if (pages[huge_page].valid || findFreeHugeBlock() != -1) {
+            bool resident = pageInLocked(process_id, static_cast<int>(huge_page));
+            referenceLocked(pages[huge_page]);
+            return resident;
+        }
+        demoteLocked(process_id);
+    }
+    else if (!pages[std::min(page, pages.size() - 1)].valid && promotableLocked(process_id, pages)) {
+        promoteLocked(process_id);
+        size_t huge_page = std::min(page / huge_frames, pages.size() - 1);
+        bool resident = pageInLocked(process_id, static_cast<int>(huge_page));
+        referenceLocked(pages[huge_page]);
+        return resident;
+    }
+
+    size_t base_page = std::min(page, pages.size() - 1);
+    bool resident = pageInLocked(process_id, static_cast<int>(base_page));
+    referenceLocked(pages[base_page]);
+    return resident;
+}
+
 // Swaps out the oldest process to backing store
 void PagingAllocator::swapOutOldest() {
-    if (backing_store.empty()) return;
+    std::lock_guard<std::mutex> lock(mtx);
+    swapOutOldestLocked(-1);
+}
 
-    int oldest_process_id = backing_store.front();
-    backing_store.pop();
+// Pages out every resident page of the oldest process other than the requester.
+// Returns false if there is no such process.
+bool PagingAllocator::swapOutOldestLocked(int requesting_process_id) {
+    for (auto it = resident_processes.begin(); it != resident_processes.end(); ++it) {
+        if (*it == requesting_process_id) continue;
+        swapOutLocked(it);
+        return true;
+    }
+    return false;
+}
 
-    deallocate(oldest_process_id);
+// Caller holds mtx. Pages out every resident page of a process and moves it
+// to the backing store.
+void PagingAllocator::swapOutLocked(std::deque<int>::iterator resident) {
+    int process_id = *resident;
+    resident_processes.erase(resident);
+    auto& table = page_tables[process_id];
+    for (int page = 0; page < static_cast<int>(table.size()); ++page) {
+        pageOutLocked(process_id, page);
+    }
+    backing_store.push_back(process_id);
 }
 
-// Prints the current memory state
-void PagingAllocator::printMemoryState() {
-    size_t used_memory = 0;
-    size_t free_memory = total_frames * frame_size;
+// Caller holds mtx. Swaps out the resident process that touched memory least
+// recently, which is the one least likely to be on a core. Returns false if
+// no process is resident.
+bool PagingAllocator::swapOutIdlestLocked() {
+    auto idlest = resident_processes.end();
+    uint64_t idlest_access = UINT64_MAX;
+    for (auto it = resident_processes.begin(); it != resident_processes.end(); ++it) {
+        auto accessed = last_access.find(*it);
+        uint64_t when = accessed == last_access.end() ? 0 : accessed->second;
+        if (when < idlest_access) {
+            idlest_access = when;
+            idlest = it;
+        }
+    }
+    if (idlest == resident_processes.end()) return false;
+
+    size_t paged_out = pages_paged_out;
+    swapOutLocked(idlest);
+    swapper_page_outs += pages_paged_out - paged_out;
+    ++swapper_swap_outs;
+    return true;
+}
+
+// Caller holds mtx. Pages in the page a process next in line for a core will
+// touch, if a frame is free; never evicts for it. The process also counts as
+// just used, so the swapper does not pick it to swap out next.
+void PagingAllocator::pageAheadLocked(int process_id, size_t offset) {
+    auto table = page_tables.find(process_id);
+    if (table == page_tables.end() || table->second.empty()) return;
+
+    std::vector<PageTableEntry>& pages = table->second;
+    size_t page = offset / frame_size;
+    if (pages.front().huge) page /= huge_frames;
+    page = std::min(page, pages.size() - 1);
+    last_access[process_id] = ++access_clock;
+    if (pages[page].valid || freeFrames() == 0) return;
+    if (pageInLocked(process_id, static_cast<int>(page)) && pages[page].valid) {
+        ++swapper_page_ins;
+    }
+}
+
+// Caller may hold mtx.
+void PagingAllocator::wakeSwapper() {
+    {
+        std::lock_guard<std::mutex> lock(swap_mtx);
+        if (swap_out_wanted) return;
+        swap_out_wanted = true;
+    }
+    swap_cv.notify_one();
+}
 
-    for (const auto& frame : frame_usage) {
-        if (frame) {
-            used_memory += frame_size;
-            free_memory -= frame_size;
+void PagingAllocator::prepareDispatch(int process_id, size_t offset) {
+    if (swapper_free_frames == 0) return;
+    {
+        std::lock_guard<std::mutex> lock(swap_mtx);
+        swap_ins.push_back({ process_id, offset });
+    }
+    swap_cv.notify_one();
+}
+
+// Swapper thread. It is woken when free frames fall under
+// swapper_free_frames and each pass evicts until twice that many are free, so
+// that it is not woken again on the next fault: pages outside every working
+// set first when those are tracked, then whole processes, least recently run
+// first. The pass then pages in the processes next in line for a core while
+// frames above the watermark are free. Faults waiting for a frame are woken
+// after every pass.
+void PagingAllocator::swapperLoop() {
+    std::vector<Dispatch> dispatches;
+    std::unique_lock<std::mutex> swap_lock(swap_mtx);
+    while (true) {
+        swap_cv.wait(swap_lock, [&] { return swapper_stopping || swap_out_wanted || !swap_ins.empty(); });
+        if (swapper_stopping) break;
+        swap_out_wanted = false;
+        dispatches.swap(swap_ins);
+        swap_lock.unlock();
+
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            bool refill = freeFrames() < swapper_free_frames;
+            swapper_stalled = false;
+            while (refill && freeFrames() < 2 * swapper_free_frames) {
+                if (working_set_window > 0 && evictColdPageLocked()) {
+                    ++swapper_page_outs;
+                    continue;
+                }
+                if (!swapOutIdlestLocked()) {
+                    swapper_stalled = true;
+                    break;
+                }
+            }
+            for (const Dispatch& next : dispatches) {
+                if (freeFrames() <= swapper_free_frames) break;
+                pageAheadLocked(next.process_id, next.offset);
+            }
+            ++swapper_passes;
         }
+        frames_freed.notify_all();
+        dispatches.clear();
+        swap_lock.lock();
     }
+}
+
+// Internal fragmentation: unused tails of each process's last page
+double PagingAllocator::getFragmentation() const {
+    size_t reserved = reserved_kb.load(std::memory_order_relaxed);
+    size_t requested = requested_kb.load(std::memory_order_relaxed);
+    if (reserved == 0 || requested >= reserved) return 0.0;
+    return static_cast<double>(reserved - requested) / static_cast<double>(reserved);
+}
+
+PagingAllocator::PagingStats PagingAllocator::getPagingStats() const {
+    PagingStats stats;
+    stats.page_table_entries = page_table_entries.load(std::memory_order_relaxed);
+    stats.page_table_bytes = stats.page_table_entries * sizeof(PageTableEntry);
+    stats.huge_page_kb = static_cast<size_t>(huge_frames) * frame_size;
+    stats.huge_pages_used = huge_pages_used.load(std::memory_order_relaxed);
+    stats.huge_page_faults = huge_page_faults.load(std::memory_order_relaxed);
+    stats.promotions = promotions.load(std::memory_order_relaxed);
+    stats.demotions = demotions.load(std::memory_order_relaxed);
+    stats.shared_frames = shared_frames.load(std::memory_order_relaxed);
+    stats.forks = forks.load(std::memory_order_relaxed);
+    stats.cow_copies = cow_copies.load(std::memory_order_relaxed);
+    stats.working_set_frames = working_set_frames.load(std::memory_order_relaxed);
+    stats.prefetched_pages = prefetched_pages.load(std::memory_order_relaxed);
+    stats.prefetch_hits = prefetch_hits.load(std::memory_order_relaxed);
+    stats.working_set_evictions = working_set_evictions.load(std::memory_order_relaxed);
+    stats.swapper_page_outs = swapper_page_outs.load(std::memory_order_relaxed);
+    stats.swapper_swap_outs = swapper_swap_outs.load(std::memory_order_relaxed);
+    stats.swapper_page_ins = swapper_page_ins.load(std::memory_order_relaxed);
+    stats.frame_waits = frame_waits.load(std::memory_order_relaxed);
+    return stats;
+}
+
+// Prints the current memory state
+void PagingAllocator::printMemoryState() {
+    std::lock_guard<std::mutex> lock(mtx);
+    size_t used_memory = getUsedMemory();
+    size_t free_memory = static_cast<size_t>(total_frames) * frame_size - used_memory;
 
     std::cout << "Used memory: " << used_memory << " KB\n";
     std::cout << "Free memory: " << free_memory << " KB\n";
@@ -118,19 +785,154 @@ void PagingAllocator::printMemoryState() {
 
 // Prints a high-level overview of memory allocation
 void PagingAllocator::printProcessSMI() {
+    std::lock_guard<std::mutex> lock(mtx);
     std::cout << "Process SMI:\n";
     for (const auto& entry : page_tables) {
-        std::cout << "Process ID: " << entry.first << ", Pages: " << entry.second.size() << "\n";
+        bool huge = !entry.second.empty() && entry.second.front().huge;
+        std::cout << "Process ID: " << entry.first << ", Pages: " << entry.second.size() << (huge ? " (huge)" : "");
+        auto working_set = working_sets.find(entry.first);
+        if (working_set_window > 0 && working_set != working_sets.end()) {
+            std::cout << ", Working set: " << working_set->second << " frames";
+        }
+        std::cout << "\n";
     }
 }
 
 // Prints fine-grained memory details
 void PagingAllocator::printVMStat() {
+    std::lock_guard<std::mutex> lock(mtx);
     std::cout << "VMStat:\n";
     for (const auto& entry : page_tables) {
         std::cout << "Process ID: " << entry.first << "\n";
         for (const auto& page : entry.second) {
-            std::cout << "  Page Frame: " << page.frame_number << ", Valid: " << page.valid << "\n";
+            std::cout << "  Page Frame: " << page.frame_number << ", Valid: " << page.valid << (page.huge ? ", Huge: 1" : "")
+                << (page.valid && frame_refs[page.frame_number] > 1 ? ", Shared: " + std::to_string(frame_refs[page.frame_number]) : "") << "\n";
+        }
+    }
+}
+
+void PagingAllocator::save(Checkpoint::Writer& out) const {
+    std::lock_guard<std::mutex> lock(mtx);
+    out.add(Checkpoint::Section::PagingInfo, PagingInfo{ total_frames, frame_size, pages_paged_in.load(), pages_paged_out.load(),
+        huge_frames, 0, huge_page_faults.load(), promotions.load(), demotions.load(), forks.load(), cow_copies.load(),
+        prefetched_pages.load(), prefetch_hits.load(), working_set_evictions.load(),
+        swapper_page_outs.load(), swapper_swap_outs.load(), swapper_page_ins.load(), frame_waits.load() });
+    out.add(Checkpoint::Section::PagingFrames, frame_refs);
+
+    std::vector<PageTableRecord> tables;
+    std::vector<PageEntryRecord> entries;
+    tables.reserve(page_tables.size());
+    for (const auto& [process_id, table] : page_tables) {
+        auto size = process_sizes.find(process_id);
+        bool huge = !table.empty() && table.front().huge;
+        tables.push_back({ process_id, size == process_sizes.end() ? 0 : size->second, static_cast<uint32_t>(table.size()), huge ? 1u : 0u });
+        for (const PageTableEntry& entry : table) {
+            uint32_t flags = (entry.valid ? ENTRY_VALID : 0) | (entry.referenced ? ENTRY_REFERENCED : 0) | (entry.prefetched ? ENTRY_PREFETCHED : 0);
+            entries.push_back({ entry.frame_number, flags | static_cast<uint32_t>(entry.history) << 8 });
+        }
+    }
+    out.add(Checkpoint::Section::PagingTables, std::move(tables));
+    out.add(Checkpoint::Section::PagingEntries, std::move(entries));
+    out.add(Checkpoint::Section::PagingResident, std::vector<int32_t>(resident_processes.begin(), resident_processes.end()));
+    out.add(Checkpoint::Section::PagingBacking, std::vector<int32_t>(backing_store.begin(), backing_store.end()));
+}
+
+// Frame counts are recomputed from the page tables, which must agree with the frame map
+bool PagingAllocator::load(const Checkpoint::Reader& in) {
+    const PagingInfo* info = in.record<PagingInfo>(Checkpoint::Section::PagingInfo);
+    if (!info || info->total_frames != total_frames || info->frame_size != frame_size || info->huge_frames != huge_frames) return false;
+    auto frames = in.section<uint32_t>(Checkpoint::Section::PagingFrames);
+    auto tables = in.section<PageTableRecord>(Checkpoint::Section::PagingTables);
+    auto entries = in.section<PageEntryRecord>(Checkpoint::Section::PagingEntries);
+    auto resident = in.section<int32_t>(Checkpoint::Section::PagingResident);
+    auto backing = in.section<int32_t>(Checkpoint::Section::PagingBacking);
+    if (frames.size() != static_cast<size_t>(total_frames)) return false;
+
+    size_t entry_count = 0;
+    size_t valid_huge_pages = 0;
+    std::vector<uint32_t> mappings(total_frames, 0); // Must match the saved reference counts
+    for (const PageTableRecord& table : tables) {
+        if (table.pages > entries.size() - entry_count) return false;
+        if (table.huge && huge_frames == 0) return false;
+        int span = table.huge ? huge_frames : 1;
+        for (size_t i = entry_count; i < entry_count + table.pages; ++i) {
+            if (!(entries[i].flags & ENTRY_VALID)) continue;
+            int first = entries[i].frame_number;
+            if (first < 0 || first > total_frames - span || first % span != 0) return false;
+            for (int frame = first; frame < first + span; ++frame) {
+                ++mappings[frame];
+            }
+            if (table.huge) ++valid_huge_pages;
         }
+        entry_count += table.pages;
     }
+    if (entry_count != entries.size()) return false;
+    if (!std::equal(mappings.begin(), mappings.end(), frames.begin())) return false;
+
+    std::lock_guard<std::mutex> lock(mtx);
+    frame_refs.assign(frames.begin(), frames.end());
+    int valid_frames = 0;
+    size_t shared = 0;
+    for (int frame = 0; frame < total_frames; ++frame) {
+        frame_usage[frame] = frame_refs[frame] != 0;
+        valid_frames += frame_refs[frame] != 0 ? 1 : 0;
+        shared += frame_refs[frame] > 1 ? 1 : 0;
+    }
+    page_tables.clear();
+    process_sizes.clear();
+    working_sets.clear();
+    last_faults.clear();
+    last_access.clear();
+    page_tables.reserve(tables.size());
+    process_sizes.reserve(tables.size());
+    size_t requested = 0;
+    size_t reserved = 0;
+    size_t working_set_total = 0;
+    const PageEntryRecord* entry = entries.data();
+    for (const PageTableRecord& table : tables) {
+        std::vector<PageTableEntry>& pages = page_tables[table.process_id];
+        pages.reserve(table.pages);
+        size_t working_set = 0;
+        for (uint32_t i = 0; i < table.pages; ++i, ++entry) {
+            pages.push_back({ entry->frame_number, (entry->flags & ENTRY_VALID) != 0, table.huge != 0,
+                (entry->flags & ENTRY_REFERENCED) != 0, (entry->flags & ENTRY_PREFETCHED) != 0, static_cast<uint8_t>(entry->flags >> 8) });
+            if (pages.back().valid) {
+                std::fill_n(frame_owners.begin() + entry->frame_number, framesOf(pages.back()), FrameOwner{ table.process_id, static_cast<int>(i) });
+            }
+            if (working_set_window > 0 && inWorkingSet(pages.back())) working_set += static_cast<size_t>(framesOf(pages.back()));
+        }
+        if (working_set_window > 0) {
+            working_sets[table.process_id] = working_set;
+            working_set_total += working_set;
+        }
+        process_sizes[table.process_id] = table.size;
+        requested += static_cast<size_t>(table.size);
+        reserved += static_cast<size_t>(table.pages) * (table.huge ? huge_frames : 1) * frame_size;
+    }
+    resident_processes.assign(resident.begin(), resident.end());
+    backing_store.assign(backing.begin(), backing.end());
+
+    used_frames = valid_frames;
+    requested_kb = requested;
+    reserved_kb = reserved;
+    huge_pages_used = valid_huge_pages;
+    shared_frames = shared;
+    page_table_entries = entries.size();
+    working_set_frames = working_set_total;
+    accesses_since_sample = 0;
+    pages_paged_in = static_cast<size_t>(info->pages_paged_in);
+    pages_paged_out = static_cast<size_t>(info->pages_paged_out);
+    huge_page_faults = static_cast<size_t>(info->huge_page_faults);
+    promotions = static_cast<size_t>(info->promotions);
+    demotions = static_cast<size_t>(info->demotions);
+    forks = static_cast<size_t>(info->forks);
+    cow_copies = static_cast<size_t>(info->cow_copies);
+    prefetched_pages = static_cast<size_t>(info->prefetched_pages);
+    prefetch_hits = static_cast<size_t>(info->prefetch_hits);
+    working_set_evictions = static_cast<size_t>(info->working_set_evictions);
+    swapper_page_outs = static_cast<size_t>(info->swapper_page_outs);
+    swapper_swap_outs = static_cast<size_t>(info->swapper_swap_outs);
+    swapper_page_ins = static_cast<size_t>(info->swapper_page_ins);
+    frame_waits = static_cast<size_t>(info->frame_waits);
+    return true;
 }
@@ -1,41 +1,162 @@
 #pragma once
+#include <cstdint>
 #include <vector>
 #include <unordered_map>
 #include <string>
 #include <iostream>
-#include <queue> // Include the queue header
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <thread>
+#include "MemoryManager.h"
 
 struct PageTableEntry {
-    int frame_number; // The frame index
+    int frame_number; // The frame index; the first of the run for a huge page
     bool valid;       // Valid bit indicating if the page is in memory
+    bool huge;        // Maps huge_frames contiguous frames instead of one
+    bool referenced = false; // Touched since the last working-set sample
+    bool prefetched = false; // Read ahead and not touched yet
+    uint8_t history = 0;     // Referenced bits of the last eight samples, newest lowest
 };
 
-class PagingAllocator {
+// Optional paging features; all off by default.
+struct PagingOptions {
+    int huge_page_size = 0;     // KB, a multiple of the frame size; 0 for none
+    int huge_threshold = 0;     // Smallest process in KB that gets huge pages; 0 for huge_page_size
+    int working_set_window = 0; // Samples a reference keeps a page in its working set, up to 8; 0 for none
+    int prefetch_pages = 0;     // Pages read ahead after a sequential fault
+    int swapper_free_frames = 0; // Free frames a background swapper keeps, up to a quarter of memory; 0 for none
+};
+
+class PagingAllocator : public MemoryManager {
 private:
-    size_t pages_paged_in = 0;  // Number of pages paged into memory
-    size_t pages_paged_out = 0; // Number of pages paged out of memory
+    std::atomic<size_t> pages_paged_in{ 0 };  // Number of pages paged into memory
+    std::atomic<size_t> pages_paged_out{ 0 }; // Number of pages paged out of memory
     int total_frames;                   // Total number of frames
     int frame_size;                     // Size of each frame in KB
+    std::atomic<int> used_frames{ 0 };  // Frames currently holding a page
+    std::atomic<size_t> requested_kb{ 0 }; // Memory asked for by resident page tables
+    std::atomic<size_t> reserved_kb{ 0 };  // Whole pages backing those requests
+    int huge_frames;                    // Frames per huge page, 0 when huge pages are off
+    int huge_threshold;                 // Smallest process in KB that gets huge pages
+    std::atomic<size_t> huge_pages_used{ 0 };    // Resident huge page mappings
+    std::atomic<size_t> page_table_entries{ 0 }; // Entries across all page tables
+    std::atomic<size_t> huge_page_faults{ 0 };   // Faults that brought in a whole huge page
+    std::atomic<size_t> promotions{ 0 };         // Page tables switched to huge pages
+    std::atomic<size_t> demotions{ 0 };          // Page tables split back into base pages
+    std::atomic<size_t> shared_frames{ 0 };      // Frames mapped by more than one process
+    std::atomic<size_t> forks{ 0 };              // Page tables created by forkProcess
+    std::atomic<size_t> cow_copies{ 0 };         // Shared pages copied on a write
+    int working_set_window;             // 0 when working sets are not tracked
+    int prefetch_pages;
+    size_t accesses_since_sample = 0;   // A sample is taken once per round of the resident processes
+    std::atomic<size_t> working_set_frames{ 0 }; // Sum of the per-process working sets
+    std::atomic<size_t> prefetched_pages{ 0 };   // Pages read ahead of a fault
+    std::atomic<size_t> prefetch_hits{ 0 };      // Prefetched pages touched before being paged out
+    std::atomic<size_t> working_set_evictions{ 0 }; // Pages paged out because they left every working set
+    std::unordered_map<int, size_t> working_sets; // Frames per process referenced within the window
+    std::unordered_map<int, int> last_faults;     // Highest page each process faulted or prefetched, for sequence detection
+    // Background swapper. It keeps at least swapper_free_frames frames free
+    // and pages in processes about to be dispatched; faults then only take
+    // free frames, and wait on frames_freed when there are none.
+    int swapper_free_frames;            // 0 when there is no swapper
+    std::thread swapper;
+    std::mutex swap_mtx;                // Guards the requests below; taken after mtx, never before
+    std::condition_variable swap_cv;
+    bool swap_out_wanted = false;       // Free frames fell under the watermark
+    bool swapper_stopping = false;
+    struct Dispatch {
+        int process_id;
+        size_t offset;
+    };
+    std::vector<Dispatch> swap_ins;     // Processes next in line for a core
+    std::condition_variable frames_freed; // Waited on with mtx by faults that found no free frame
+    uint64_t swapper_passes = 0;        // Completed passes; guarded by mtx
+    bool swapper_stalled = false;       // The last pass ran out of pages to evict; guarded by mtx
+    uint64_t access_clock = 0;          // Orders accesses for picking the idlest process
+    std::unordered_map<int, uint64_t> last_access;
+    std::atomic<size_t> swapper_page_outs{ 0 };
+    std::atomic<size_t> swapper_swap_outs{ 0 };
+    std::atomic<size_t> swapper_page_ins{ 0 };
+    std::atomic<size_t> frame_waits{ 0 };
     std::vector<bool> frame_usage;      // Frame occupancy
+    std::vector<uint32_t> frame_refs;   // Page-table entries mapping each frame; above 1 it is shared copy-on-write
+    struct FrameOwner {
+        int process_id;
+        int page;
+    };
+    std::vector<FrameOwner> frame_owners; // Last page mapped to each frame, for the eviction clock
+    int clock_hand = 0;
     std::unordered_map<int, std::vector<PageTableEntry>> page_tables; // Page tables for processes
-    std::queue<int> backing_store;      // Process IDs in the backing store
+    std::unordered_map<int, int> process_sizes; // Requested size in KB per process
+    std::deque<int> resident_processes; // Process IDs with pages in memory, oldest first
+    std::deque<int> backing_store;      // Process IDs swapped out to the backing store
+    mutable std::mutex mtx;             // Cores fault pages in concurrently
+
+    int findFreeFrame(int requesting_process_id);
+    bool evictColdPageLocked();
+    void sampleWorkingSetsLocked();
+    void referenceLocked(PageTableEntry& entry);
+    void prefetchLocked(int process_id, int first_page);
+    bool inWorkingSet(const PageTableEntry& entry) const {
+        return entry.referenced || (entry.history & ((1u << working_set_window) - 1)) != 0;
+    }
+    int findFreeHugeBlock() const;
+    void claimFrames(int first, int count, int process_id = -1, int page = 0);
+    void releaseFrames(int first, int count);
+    bool touchLocked(int process_id, size_t offset);
+    void copyOnWriteLocked(int process_id, size_t offset);
+    int framesOf(const PageTableEntry& entry) const { return entry.huge ? huge_frames : 1; }
+    bool allocateHugeLocked(int process_id, int size);
+    bool promotableLocked(int process_id, const std::vector<PageTableEntry>& table) const;
+    void promoteLocked(int process_id);
+    void demoteLocked(int process_id);
+    bool pageInLocked(int process_id, int page_number);
+    void pageOutLocked(int process_id, int page_number);
+    bool swapOutOldestLocked(int requesting_process_id);
+    void swapOutLocked(std::deque<int>::iterator resident);
+    bool swapOutIdlestLocked();
+    int freeFrames() const { return total_frames - used_frames.load(std::memory_order_relaxed); }
+    void pageAheadLocked(int process_id, size_t offset);
+    void wakeSwapper();
+    void swapperLoop();
+    void deallocateLocked(int process_id);
 
 public:
-    PagingAllocator(int total_memory, int frame_size);
+    PagingAllocator(int total_memory, int frame_size, const PagingOptions& options = {});
+    ~PagingAllocator() override;
+    PagingAllocator(const PagingAllocator&) = delete;
+    PagingAllocator& operator=(const PagingAllocator&) = delete;
 
     const std::vector<bool>& getFrameUsage() const {
         return frame_usage;
     }
 
-    size_t getPagesPagedIn() const { return pages_paged_in; }
-    size_t getPagesPagedOut() const { return pages_paged_out; }
+    size_t getPagesPagedIn() const { return pages_paged_in.load(std::memory_order_relaxed); }
+    size_t getPagesPagedOut() const override { return pages_paged_out.load(std::memory_order_relaxed); }
 
     bool allocate(int process_id, int size);  // Allocates memory for a process
     void deallocate(int process_id);          // Deallocates memory for a process
     void pageIn(int process_id, int page_number);  // Loads a page into memory
     void pageOut(int process_id, int page_number); // Removes a page from memory
     void swapOutOldest();                     // Swaps out the oldest process to backing store
-    void printMemoryState();                  // Prints the current memory state
+    void printMemoryState() override;         // Prints the current memory state
     void printProcessSMI();                   // Prints a high-level overview of memory allocation
     void printVMStat();                       // Prints fine-grained memory details
+
+    bool allocateProcess(int process_id, size_t size) override { return allocate(process_id, static_cast<int>(size)); }
+    void deallocateProcess(int process_id) override { deallocate(process_id); }
+    bool forkProcess(int parent_id, int child_id) override;
+    bool admitsByWorkingSet() const override { return working_set_window > 0; }
+    void access(int process_id, size_t offset, bool stored) override;
+    void prepareDispatch(int process_id, size_t offset) override;
+    size_t getTotalMemory() const override { return static_cast<size_t>(total_frames) * frame_size; }
+    size_t getUsedMemory() const override { return static_cast<size_t>(used_frames.load(std::memory_order_relaxed)) * frame_size; }
+    size_t getPageFaults() const override { return getPagesPagedIn(); }
+    size_t getFramesInUse() const override { return static_cast<size_t>(used_frames.load(std::memory_order_relaxed)); }
+    double getFragmentation() const override;
+    PagingStats getPagingStats() const override;
+    void save(Checkpoint::Writer& out) const override;
+    bool load(const Checkpoint::Reader& in) override;
 };
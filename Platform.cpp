@@ -0,0 +1,117 @@
+#include "Platform.h"
+#include <cstdlib>
+#include <iostream>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+std::tm toLocalTime(std::time_t time) {
+    std::tm local_tm{};
+#ifdef _WIN32
+    localtime_s(&local_tm, &time);
+#else
+    localtime_r(&time, &local_tm);
+#endif
+    return local_tm;
+}
+
+void clearConsole() {
+    if (enableAnsiTerminal()) {
+        std::cout << "\033[2J\033[H" << std::flush;
+        return;
+    }
+#ifdef _WIN32
+    system("cls"); // Legacy console without virtual terminal support
+#endif
+}
+
+bool enableAnsiTerminal() {
+#ifdef _WIN32
+    static const bool enabled = [] {
+        HANDLE out = GetStdHandle(STD_OUTPUT_HANDLE);
+        DWORD mode = 0;
+        if (out == INVALID_HANDLE_VALUE || !GetConsoleMode(out, &mode)) return false;
+        return SetConsoleMode(out, mode | ENABLE_VIRTUAL_TERMINAL_PROCESSING) != 0;
+    }();
+#else
+    static const bool enabled = isatty(STDOUT_FILENO) != 0;
+#endif
+    return enabled;
+}
+
+void terminalSize(int& columns, int& rows) {
+    columns = 80;
+    rows = 24;
+#ifdef _WIN32
+    CONSOLE_SCREEN_BUFFER_INFO info;
+    if (GetConsoleScreenBufferInfo(GetStdHandle(STD_OUTPUT_HANDLE), &info)) {
+        columns = info.srWindow.Right - info.srWindow.Left + 1;
+        rows = info.srWindow.Bottom - info.srWindow.Top + 1;
+    }
+#else
+    winsize size{};
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &size) == 0 && size.ws_col > 0 && size.ws_row > 0) {
+        columns = size.ws_col;
+        rows = size.ws_row;
+    }
+#endif
+}
+
+bool MappedFile::open(const std::string& path) {
+    close();
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return false;
+    LARGE_INTEGER file_size{};
+    if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0) {
+        CloseHandle(file);
+        return false;
+    }
+    // The mapping keeps the file open; its handle is not needed any more
+    HANDLE map = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+    if (!map) return false;
+    void* address = MapViewOfFile(map, FILE_MAP_READ, 0, 0, 0);
+    if (!address) {
+        CloseHandle(map);
+        return false;
+    }
+    mapping = map;
+    view = static_cast<const char*>(address);
+    length = static_cast<size_t>(file_size.QuadPart);
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat info {};
+    if (fstat(fd, &info) != 0 || info.st_size <= 0) {
+        ::close(fd);
+        return false;
+    }
+    void* address = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (address == MAP_FAILED) return false;
+    view = static_cast<const char*>(address);
+    length = static_cast<size_t>(info.st_size);
+#endif
+    return true;
+}
+
+void MappedFile::close() {
+    if (!view) return;
+#ifdef _WIN32
+    UnmapViewOfFile(view);
+    CloseHandle(static_cast<HANDLE>(mapping));
+    mapping = nullptr;
+#else
+    munmap(const_cast<char*>(view), length);
+#endif
+    view = nullptr;
+    length = 0;
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <cstddef>
+#include <ctime>
+#include <string>
+
+// Portable wrappers for the few OS-specific calls the emulator makes.
+
+// Thread-safe local time conversion (localtime_s on Windows, localtime_r elsewhere).
+std::tm toLocalTime(std::time_t time);
+
+// Clears the terminal.
+void clearConsole();
+
+// Turns on ANSI escape handling (virtual terminal mode on Windows). Returns
+// false when stdout is not a terminal that understands it. Safe to call repeatedly.
+bool enableAnsiTerminal();
+
+// Visible size of the terminal in character cells; 80x24 when unknown.
+void terminalSize(int& columns, int& rows);
+
+// Read-only mapping of a whole file (mmap, or MapViewOfFile on Windows).
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile() { close(); }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // False if the file cannot be opened, is empty or cannot be mapped.
+    bool open(const std::string& path);
+    void close();
+
+    const char* data() const { return view; }
+    size_t size() const { return length; }
+
+private:
+    const char* view = nullptr;
+    size_t length = 0;
+#ifdef _WIN32
+    void* mapping = nullptr; // HANDLE
+#endif
+};
@@ -1,28 +1,78 @@
 // Process.cpp
 
-#include "process.h"
+#include "Process.h"
+#include "Platform.h"
 #include <iomanip>
 #include <ctime>
 #include <sstream>
 #include <iostream>
+#include <random>
 
-int Process::next_process_id = 1;
+namespace {
 
-Process::Process(const std::string& pname, int commands, size_t mem)
-    : name(pname), total_commands(commands), executed_commands(0), core_id(-1),
-    process_id(next_process_id++), memory(mem) { // Initialize memory
-    start_time = std::chrono::system_clock::now();
+std::mt19937& threadGenerator() {
+    thread_local std::mt19937 gen(std::random_device{}());
+    return gen;
 }
 
+struct ProcessRecord {
+    uint32_t slot;
+    uint32_t program_length;
+    uint64_t program_offset;     // Into the Programs section
+    int64_t ready_time;          // Ages, see Checkpoint::age
+    int64_t first_dispatch_time;
+    int64_t dispatch_time;
+    int64_t waiting_time;        // Nanoseconds
+    int32_t dispatch_count;
+    int32_t group;
+    int32_t stall_cycles;
+    CpuState cpu;
+};
 
-Process::~Process() {
-    log_file.close();
+}
+
+Process::Process(std::string_view pname, int commands, size_t mem, std::mt19937& gen)
+    : Process(ProcessTable::add(pname, commands, mem)) {
+    program = generateProgram(total_commands, gen);
+}
+
+Process::Process(std::string_view pname, const Process& parent)
+    : Process(ProcessTable::add(pname, parent.total_commands, parent.memory)) {
+    program = parent.program;
+    group = parent.group;
+}
+
+Process::Process(ProcessTable::Slot row)
+    : slot(row),
+    process_id(static_cast<int>(slot) + 1),
+    name(ProcessTable::name(slot)),
+    total_commands(ProcessTable::chunk(slot).total[ProcessTable::row(slot)]),
+    executed_commands(ProcessTable::chunk(slot).executed[ProcessTable::row(slot)]),
+    start_time(ProcessTable::chunk(slot).start[ProcessTable::row(slot)]),
+    arrival_time(ProcessTable::chunk(slot).arrival[ProcessTable::row(slot)]),
+    finish_time(ProcessTable::chunk(slot).finish[ProcessTable::row(slot)]),
+    core_id(ProcessTable::chunk(slot).core[ProcessTable::row(slot)]),
+    migrations(ProcessTable::chunk(slot).migrations[ProcessTable::row(slot)]),
+    memory(ProcessTable::chunk(slot).memory[ProcessTable::row(slot)]) {
+    ready_time = arrival_time;
+}
+
+Process::Process(std::string_view pname, int commands, size_t mem)
+    : Process(pname, commands, mem, threadGenerator()) {}
+
+bool Process::markDispatched(std::chrono::steady_clock::time_point now) {
+    waiting_time += now - ready_time;
+    dispatch_time = now;
+    bool first = dispatch_count++ == 0;
+    if (first) {
+        first_dispatch_time = now;
+    }
+    return first;
 }
 
 std::string Process::get_start_time() const {
     auto now = std::chrono::system_clock::to_time_t(start_time);
-    std::tm local_tm;
-    localtime_s(&local_tm, &now);
+    std::tm local_tm = toLocalTime(now);
     std::ostringstream oss;
     oss << std::put_time(&local_tm, "%m/%d/%Y %I:%M:%S%p");
     return oss.str();
@@ -39,17 +89,75 @@ std::string Process::get_status() const {
     return oss.str();
 }
 
-void Process::displayProcessInfo() const {
+void Process::displayProcessInfo(ProcessTable::Slot slot) {
     //print the process information
+    int executed = ProcessTable::executed(slot);
+    int total = ProcessTable::total(slot);
 
-    std::cout << "Process name: " << name << "\n";
-    std::cout << "Process ID: " << process_id << "\n\n";
+    std::cout << "Process name: " << ProcessTable::name(slot) << "\n";
+    std::cout << "Process ID: " << slot + 1 << "\n\n";
 
-    if (executed_commands < total_commands) {
-        std::cout << "Current Instruction Line: " << executed_commands << "\n";
-        std::cout << "Lines of Code: " << total_commands << "\n";
+    if (executed < total) {
+        std::cout << "Current Instruction Line: " << executed << "\n";
+        std::cout << "Lines of Code: " << total << "\n";
     }
     else {
         std::cout << "Finished!\n";
     }
+    std::cout << "Core migrations: " << ProcessTable::migrations(slot) << "\n";
+}
+
+void Process::save(Checkpoint::Writer& out, const std::vector<Process*>& procs, std::chrono::steady_clock::time_point now) {
+    std::vector<ProcessRecord> records;
+    std::vector<Instruction> programs;
+    records.reserve(procs.size());
+    for (const Process* proc : procs) {
+        ProcessRecord& record = records.emplace_back();
+        record.slot = proc->slot;
+        record.program_length = static_cast<uint32_t>(proc->program.size());
+        record.program_offset = programs.size();
+        record.ready_time = Checkpoint::age(proc->ready_time, now);
+        record.first_dispatch_time = Checkpoint::age(proc->first_dispatch_time, now);
+        record.dispatch_time = Checkpoint::age(proc->dispatch_time, now);
+        record.waiting_time = std::chrono::duration_cast<std::chrono::nanoseconds>(proc->waiting_time).count();
+        record.dispatch_count = proc->dispatch_count;
+        record.group = proc->group;
+        record.stall_cycles = proc->stall_cycles;
+        record.cpu = proc->cpu;
+        programs.insert(programs.end(), proc->program.begin(), proc->program.end());
+    }
+    out.add(Checkpoint::Section::Processes, std::move(records));
+    out.add(Checkpoint::Section::Programs, std::move(programs));
+}
+
+bool Process::load(const Checkpoint::Reader& in, std::chrono::steady_clock::time_point now, std::vector<Process*>& procs) {
+    if (!in.has(Checkpoint::Section::Processes)) return false;
+    auto records = in.section<ProcessRecord>(Checkpoint::Section::Processes);
+    auto programs = in.section<Instruction>(Checkpoint::Section::Programs);
+
+    ProcessTable::Slot rows = ProcessTable::size();
+    for (const ProcessRecord& record : records) {
+        if (record.slot >= rows || record.program_offset > programs.size() || record.program_length > programs.size() - record.program_offset) {
+            return false;
+        }
+        if (record.cpu.pc > record.program_length || record.cpu.loop_depth > MAX_FOR_DEPTH) {
+            return false;
+        }
+    }
+
+    procs.reserve(procs.size() + records.size());
+    for (const ProcessRecord& record : records) {
+        Process* proc = new Process(record.slot);
+        proc->program.assign(programs.begin() + record.program_offset, programs.begin() + record.program_offset + record.program_length);
+        proc->cpu = record.cpu;
+        proc->ready_time = Checkpoint::instant(record.ready_time, now);
+        proc->first_dispatch_time = Checkpoint::instant(record.first_dispatch_time, now);
+        proc->dispatch_time = Checkpoint::instant(record.dispatch_time, now);
+        proc->waiting_time = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::nanoseconds(record.waiting_time));
+        proc->dispatch_count = record.dispatch_count;
+        proc->group = record.group;
+        proc->stall_cycles = record.stall_cycles;
+        procs.push_back(proc);
+    }
+    return true;
 }
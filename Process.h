@@ -4,24 +4,64 @@
 #include <chrono>
 #include <sstream>
 #include <iomanip>
+#include <vector>
+#include <atomic>
+#include <memory>
+#include <random>
+#include <string_view>
+#include "Instruction.h"
+#include "ProcessTable.h"
 
 class Process {
-private:
-    static int next_process_id;
-
 public:
-    std::string name;
-    int total_commands;
-    int executed_commands;
-    std::ofstream log_file;
-    std::chrono::time_point<std::chrono::system_clock> start_time;
-    int core_id;
-    int process_id;
-    size_t memory; // Add this line to represent memory usage.
+    // Columns that outlive the process are kept in its ProcessTable row; the
+    // references below point into that row.
+    const ProcessTable::Slot slot;
+    const int process_id;
+    const std::string_view name;                       // Interned in the table's name arena
+    const int& total_commands;
+    std::atomic<int>& executed_commands;               // Written only by the core that owns the process
+    std::unique_ptr<std::ofstream> log_file;           // Opened only when a log is requested
+    std::chrono::system_clock::time_point& start_time;
+    std::chrono::steady_clock::time_point& arrival_time; // Submitted to a scheduler
+    std::chrono::steady_clock::time_point& finish_time;  // Retired after its last instruction
+    std::chrono::steady_clock::time_point ready_time;          // Entered the ready queue: arrival, preemption or wake-up
+    std::chrono::steady_clock::time_point first_dispatch_time; // First placed on a core; zero until then
+    std::chrono::steady_clock::time_point dispatch_time;       // Start of the current quantum
+    std::chrono::steady_clock::duration waiting_time{};        // Total time spent off a core so far
+    int dispatch_count = 0;
+    int group = 0;                    // CpuGroups index, chosen by whoever creates the process
+    int& core_id;
+    uint32_t& migrations;             // Counted by SoftAffinity::place
+    uint64_t off_core_since = 0;      // Scheduler time it arrived or last left a core, see SoftAffinity
+    int stall_cycles = 0;             // Left to stall after a migration before it runs again
+    const size_t& memory;
+    std::vector<Instruction> program; // Compiled bytecode, see Interpreter
+    CpuState cpu;                     // Program counter, loop stack and variables
 
-    Process(const std::string& pname, int commands, size_t mem); // Update the constructor declaration.
-    ~Process();
+    Process(std::string_view pname, int commands, size_t mem);
+    // Draws the program from `gen`, so a seeded generator reproduces the workload
+    Process(std::string_view pname, int commands, size_t mem, std::mt19937& gen);
+    // A new process running `parent`'s program from the start
+    Process(std::string_view pname, const Process& parent);
+    // Attaches to an existing table row, with an empty program
+    explicit Process(ProcessTable::Slot row);
+    Process(const Process&) = delete;
+    Process& operator=(const Process&) = delete;
     std::string get_start_time() const;
+    // Scheduling timestamps, called by the scheduler under its lock.
+    // markDispatched returns true on the first dispatch.
+    bool markDispatched(std::chrono::steady_clock::time_point now);
+    void markReady(std::chrono::steady_clock::time_point now) { ready_time = now; }
     std::string get_status() const;
-    void displayProcessInfo() const;
+    void displayProcessInfo() const { displayProcessInfo(slot); }
+    // Also works after the process has retired and its object is gone
+    static void displayProcessInfo(ProcessTable::Slot slot);
+
+    // Checkpoint support: bytecode, CPU state and scheduling timestamps of
+    // live processes, in the given order. load recreates them on the rows
+    // ProcessTable::load restored, or fails without creating any if a
+    // record does not match the table.
+    static void save(Checkpoint::Writer& out, const std::vector<Process*>& procs, std::chrono::steady_clock::time_point now);
+    static bool load(const Checkpoint::Reader& in, std::chrono::steady_clock::time_point now, std::vector<Process*>& procs);
 };
@@ -0,0 +1,181 @@
+#include "ProcessGenerator.h"
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <mutex>
+#include "Metrics.h"
+#include "Process.h"
+#include "ReportRenderer.h"
+
+namespace {
+
+const char* kindName(ArrivalModel::Kind kind) {
+    switch (kind) {
+    case ArrivalModel::Kind::Poisson: return "poisson";
+    case ArrivalModel::Kind::OnOff: return "on-off";
+    default: return "constant";
+    }
+}
+
+int64_t steadyNanoseconds() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+}
+
+bool ArrivalModel::parseKind(const std::string& value, Kind& kind) {
+    if (value == "constant") kind = Kind::Constant;
+    else if (value == "poisson") kind = Kind::Poisson;
+    else if (value == "on-off") kind = Kind::OnOff;
+    else return false;
+    return true;
+}
+
+ArrivalModel::ArrivalModel(Kind kind, double mean_gap, double on, double off, double first)
+    : kind(kind), gap(mean_gap), on(on), off(off), time(first), burst_end(on) {
+    if (kind == Kind::OnOff) {
+        if (on <= 0) {
+            this->kind = Kind::Poisson;
+        }
+        else {
+            gap = mean_gap * on / (on + off); // Arrivals crowd into the bursts
+        }
+    }
+}
+
+ProcessGenerator::Settings ProcessGenerator::fromConfig(const Config::ConfigParameters& config, int groups, long long seed) {
+    Settings settings;
+    ArrivalModel::parseKind(config.arrival_model, settings.model);
+    settings.rate = config.batch_process_freq > 0 ? 1.0 / config.batch_process_freq : 1.0;
+    settings.burst_on = std::chrono::milliseconds(config.burst_on_ms);
+    settings.burst_off = std::chrono::milliseconds(config.burst_off_ms);
+    settings.threads = config.arrival_threads;
+    settings.min_ins = config.min_ins;
+    settings.max_ins = config.max_ins;
+    settings.min_mem = config.min_mem_per_proc;
+    settings.max_mem = config.max_mem_per_proc;
+    settings.groups = groups;
+    settings.seed = seed;
+    return settings;
+}
+
+ProcessGenerator::ProcessGenerator(Submit submit, std::shared_mutex& table_guard, std::atomic<int>& counter)
+    : submit(std::move(submit)), table_guard(table_guard), counter(counter) {}
+
+ProcessGenerator::~ProcessGenerator() {
+    stop();
+}
+
+void ProcessGenerator::start(const Settings& settings) {
+    stop();
+    created.store(0, std::memory_order_relaxed);
+    target_rate.store(settings.rate, std::memory_order_relaxed);
+    model.store(settings.model, std::memory_order_relaxed);
+    producer_count.store(std::max(settings.threads, 1), std::memory_order_relaxed);
+    started_at.store(steadyNanoseconds(), std::memory_order_relaxed);
+    stopped_at.store(0, std::memory_order_relaxed);
+    active = true;
+    for (int i = 0; i < std::max(settings.threads, 1); ++i) {
+        producers.emplace_back(&ProcessGenerator::produce, this, i, settings);
+    }
+}
+
+void ProcessGenerator::stop() {
+    if (!active.exchange(false)) return;
+    for (std::thread& producer : producers) {
+        producer.join();
+    }
+    producers.clear();
+    stopped_at.store(steadyNanoseconds(), std::memory_order_relaxed);
+}
+
+double ProcessGenerator::elapsedSeconds() const {
+    int64_t begin = started_at.load(std::memory_order_relaxed);
+    if (begin == 0) return 0;
+    int64_t end = stopped_at.load(std::memory_order_relaxed);
+    return static_cast<double>((end != 0 ? end : steadyNanoseconds()) - begin) / 1e9;
+}
+
+double ProcessGenerator::achievedRate() const {
+    double elapsed = elapsedSeconds();
+    return elapsed > 0 ? static_cast<double>(generated()) / elapsed : 0;
+}
+
+// Producer thread. Arrival times are seconds since start; everything due by
+// the time the producer wakes is created and submitted as one burst, and a
+// producer that falls behind catches up in bursts of MAX_BURST rather than
+// dropping arrivals, so the achieved rate shows how far behind it is.
+void ProcessGenerator::produce(int index, Settings settings) {
+    int threads = std::max(settings.threads, 1);
+    double gap = threads / std::max(settings.rate, 1e-9);
+    // Constant producers are staggered so together they arrive evenly
+    double first = settings.model == ArrivalModel::Kind::Constant ? gap * index / threads : 0;
+    ArrivalModel arrivals(settings.model, gap,
+        std::chrono::duration<double>(settings.burst_on).count(), std::chrono::duration<double>(settings.burst_off).count(), first);
+
+    std::mt19937 gen(settings.seed >= 0 ? static_cast<std::mt19937::result_type>(settings.seed + index) : std::random_device{}());
+    std::uniform_int_distribution<> instruction_dist(settings.min_ins, std::max(settings.min_ins, settings.max_ins));
+    std::uniform_int_distribution<size_t> memory_dist(settings.min_mem, std::max(settings.min_mem, settings.max_mem));
+    int groups = std::max(settings.groups, 1);
+
+    auto begin = std::chrono::steady_clock::now();
+    double next = arrivals.next(gen);
+    std::vector<Process*> burst;
+    burst.reserve(MAX_BURST);
+    char name[32] = "process";
+    const size_t prefix = std::strlen(name);
+
+    while (active.load(std::memory_order_relaxed)) {
+        double now = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+        size_t due = 0;
+        for (; next <= now && due < MAX_BURST; ++due) {
+            next = arrivals.next(gen);
+        }
+
+        if (due > 0) {
+            std::shared_lock<std::shared_mutex> guard(table_guard);
+            // One block of names for the whole burst
+            int first_number = counter.fetch_add(static_cast<int>(due), std::memory_order_relaxed) + 1;
+            burst.clear();
+            for (size_t i = 0; i < due; ++i) {
+                int number = first_number + static_cast<int>(i);
+                char* end = std::to_chars(name + prefix, name + sizeof(name), number).ptr;
+                Process* proc = new Process(std::string_view(name, static_cast<size_t>(end - name)), instruction_dist(gen), memory_dist(gen), gen);
+                proc->group = (number - 1) % groups;
+                burst.push_back(proc);
+            }
+            submit(burst);
+            created.fetch_add(due, std::memory_order_relaxed);
+        }
+
+        if (due < MAX_BURST) {
+            // Short sleeps keep stop() prompt at low rates
+            auto wake = begin + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(next));
+            std::this_thread::sleep_until(std::min(wake, std::chrono::steady_clock::now() + std::chrono::milliseconds(100)));
+        }
+    }
+}
+
+void ProcessGenerator::collectMetrics(MetricsWriter& out) const {
+    out.family("csopesy_generator_processes_total", "counter", "Processes the test generator created since it last started.");
+    out.sample("csopesy_generator_processes_total", static_cast<double>(generated()));
+    out.family("csopesy_generator_target_rate", "gauge", "Arrivals per second the test generator aims for.");
+    out.sample("csopesy_generator_target_rate", targetRate());
+    out.family("csopesy_generator_achieved_rate", "gauge", "Arrivals per second the test generator achieved since it last started.");
+    out.sample("csopesy_generator_achieved_rate", achievedRate());
+}
+
+void ProcessGenerator::appendReport(ReportRenderer& report) const {
+    report.appendNumber(static_cast<long long>(generated()));
+    report.append(" processes in ");
+    report.appendFixed(elapsedSeconds(), 2, 0);
+    report.append(" s: ");
+    report.appendFixed(achievedRate(), 1, 0);
+    report.append("/s of ");
+    report.appendFixed(targetRate(), 1, 0);
+    report.append("/s target (");
+    report.append(kindName(model.load(std::memory_order_relaxed)));
+    report.append(", ");
+    report.appendNumber(producer_count.load(std::memory_order_relaxed));
+    report.append(producer_count.load(std::memory_order_relaxed) == 1 ? " producer)\n" : " producers)\n");
+}
@@ -0,0 +1,132 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <random>
+#include <shared_mutex>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Config.h"
+
+class Process;
+class MetricsWriter;
+class ReportRenderer;
+
+// Arrival times of a process stream, in whatever unit the mean gap is given
+// in (seconds for the producer threads, cycles for a lockstep arrival
+// source). "constant" spaces arrivals evenly, "poisson" draws exponential
+// gaps, and "on-off" alternates bursts of Poisson arrivals with silences
+// while keeping the same mean rate. On-off phases start at time 0, so
+// several streams with the same phase lengths burst together.
+class ArrivalModel {
+public:
+    enum class Kind { Constant, Poisson, OnOff };
+    // "constant", "poisson" or "on-off"; false for anything else
+    static bool parseKind(const std::string& value, Kind& kind);
+
+    ArrivalModel(Kind kind, double mean_gap, double on = 0, double off = 0, double first = 0);
+
+    // Time of the next arrival; non-decreasing. Constant arrivals draw
+    // nothing from `gen`.
+    template <typename Generator>
+    double next(Generator& gen);
+
+private:
+    Kind kind;
+    double gap;          // Between arrivals; during bursts for on-off
+    double on, off;
+    double time;         // Of the last arrival, or the first one for constant
+    double burst_end;    // End of the current on phase
+};
+
+// Creates processes at a target rate on several producer threads and hands
+// them to `submit` in bursts: every arrival that came due since a producer
+// last woke goes in one call, at most MAX_BURST at a time. Each producer
+// generates its share of the rate with a generator of its own, so the only
+// state they share is the name counter and the statistics.
+//
+// Producers hold `table_guard` shared while they create and submit a burst,
+// so whoever needs the process table to stand still (checkpoint, restore,
+// fork) takes it exclusively.
+class ProcessGenerator {
+public:
+    static constexpr size_t MAX_BURST = 1024;
+
+    using Submit = std::function<void(std::span<Process* const>)>;
+
+    struct Settings {
+        ArrivalModel::Kind model = ArrivalModel::Kind::Constant;
+        double rate = 1;              // Target arrivals per second across all producers
+        std::chrono::milliseconds burst_on{ 100 };
+        std::chrono::milliseconds burst_off{ 400 };
+        int threads = 1;
+        int min_ins = 1, max_ins = 1;
+        size_t min_mem = 0, max_mem = 0;
+        int groups = 1;               // Processes are dealt round this many CPU groups
+        long long seed = -1;          // Producer i seeds with seed + i; random when negative
+    };
+    // The arrival-* and burst-* keys, 1 / batch-process-freq per second, and
+    // the instruction and memory ranges
+    static Settings fromConfig(const Config::ConfigParameters& config, int groups, long long seed = -1);
+
+    // `counter` numbers the generated processes ("process<N>"); it is shared
+    // with whoever else names processes that way.
+    ProcessGenerator(Submit submit, std::shared_mutex& table_guard, std::atomic<int>& counter);
+    ~ProcessGenerator();
+
+    void start(const Settings& settings); // Restarts the statistics
+    void stop();                          // Joins the producers
+    bool running() const { return active.load(std::memory_order_relaxed); }
+
+    uint64_t generated() const { return created.load(std::memory_order_relaxed); }
+    double targetRate() const { return target_rate.load(std::memory_order_relaxed); }
+    double achievedRate() const; // Since start, up to stop once stopped
+    double elapsedSeconds() const;
+
+    void collectMetrics(MetricsWriter& out) const; // Reads only atomics
+    // "<n> processes in <s> s: <achieved>/s of <target>/s target (<model>, <threads> producers)"
+    void appendReport(ReportRenderer& report) const;
+
+private:
+    void produce(int index, Settings settings);
+
+    Submit submit;
+    std::shared_mutex& table_guard;
+    std::atomic<int>& counter;
+
+    std::vector<std::thread> producers;
+    std::atomic<bool> active{ false };
+    std::atomic<ArrivalModel::Kind> model{ ArrivalModel::Kind::Constant }; // Of the last start, for reports
+    std::atomic<int> producer_count{ 0 };
+    std::atomic<uint64_t> created{ 0 };
+    std::atomic<double> target_rate{ 0 };
+    std::atomic<int64_t> started_at{ 0 };  // Steady clock, nanoseconds
+    std::atomic<int64_t> stopped_at{ 0 };  // 0 while running
+};
+
+template <typename Generator>
+double ArrivalModel::next(Generator& gen) {
+    switch (kind) {
+    case Kind::Constant: {
+        double due = time;
+        time += gap;
+        return due;
+    }
+    case Kind::Poisson:
+        time += std::exponential_distribution<double>(1.0 / gap)(gen);
+        return time;
+    case Kind::OnOff:
+        time += std::exponential_distribution<double>(1.0 / gap)(gen);
+        // Time drawn past the end of a burst carries over into the next one
+        while (time >= burst_end) {
+            time += off;
+            burst_end += on + off;
+        }
+        return time;
+    }
+    return time;
+}
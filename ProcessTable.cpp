@@ -0,0 +1,177 @@
+#include "ProcessTable.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+constexpr size_t NAME_BLOCK_SIZE = 1 << 20;
+
+}
+
+std::atomic<ProcessTable::Chunk*> ProcessTable::chunks_[MAX_CHUNKS] = {};
+std::atomic<ProcessTable::Slot> ProcessTable::size_{ 0 };
+std::mutex ProcessTable::append_mtx_;
+std::vector<std::unique_ptr<char[]>> ProcessTable::names_;
+size_t ProcessTable::names_used_ = NAME_BLOCK_SIZE;
+
+ProcessTable::Slot ProcessTable::add(std::string_view name, int total_commands, size_t memory) {
+    std::lock_guard<std::mutex> lock(append_mtx_);
+    Slot slot = size_.load(std::memory_order_relaxed);
+    Slot index = slot / ROWS_PER_CHUNK;
+    if (index >= MAX_CHUNKS) {
+        std::abort(); // 64M processes; nothing sensible left to do
+    }
+    if (!chunks_[index].load(std::memory_order_relaxed)) {
+        chunks_[index].store(new Chunk(), std::memory_order_release);
+    }
+
+    // Copy the name into the arena; a name never straddles two blocks
+    size_t length = std::min(name.size(), NAME_BLOCK_SIZE);
+    if (names_used_ + length > NAME_BLOCK_SIZE) {
+        names_.emplace_back(new char[NAME_BLOCK_SIZE]);
+        names_used_ = 0;
+    }
+    char* stored = names_.back().get() + names_used_;
+    std::memcpy(stored, name.data(), length);
+    names_used_ += length;
+
+    Chunk& c = *chunks_[index].load(std::memory_order_relaxed);
+    Slot r = row(slot);
+    c.executed[r].store(0, std::memory_order_relaxed);
+    c.total[r] = total_commands;
+    c.core[r] = -1;
+    c.migrations[r] = 0;
+    c.memory[r] = memory;
+    c.state[r].store(State::Submitted, std::memory_order_relaxed);
+    c.arrival[r] = std::chrono::steady_clock::now();
+    c.start[r] = std::chrono::system_clock::now();
+    c.finish[r] = {}; // Chunks are reused after a restore
+    c.name[r] = std::string_view(stored, length);
+
+    size_.store(slot + 1, std::memory_order_release);
+    return slot;
+}
+
+ProcessTable::Totals ProcessTable::totals() {
+    Totals result;
+    Slot rows = size();
+    for (Slot base = 0; base < rows; base += ROWS_PER_CHUNK) {
+        const Chunk& c = chunk(base);
+        Slot count = std::min<Slot>(ROWS_PER_CHUNK, rows - base);
+        for (Slot r = 0; r < count; ++r) {
+            State s = c.state[r].load(std::memory_order_relaxed);
+            result.processes[static_cast<size_t>(s)]++;
+            if (s == State::Running || s == State::Finished) {
+                result.executed += static_cast<uint64_t>(c.executed[r].load(std::memory_order_relaxed));
+                result.total += static_cast<uint64_t>(c.total[r]);
+            }
+        }
+    }
+    return result;
+}
+
+void ProcessTable::save(Checkpoint::Writer& out, std::chrono::steady_clock::time_point now) {
+    Slot rows = size();
+    std::vector<int32_t> executed(rows), total(rows), core(rows);
+    std::vector<uint32_t> migrations(rows);
+    std::vector<uint64_t> memory(rows);
+    std::vector<uint8_t> state(rows);
+    std::vector<int64_t> arrival(rows), start(rows), finish(rows);
+    std::vector<uint32_t> name_length(rows);
+    std::vector<char> names;
+
+    for (Slot base = 0; base < rows; base += ROWS_PER_CHUNK) {
+        const Chunk& c = chunk(base);
+        Slot count = std::min<Slot>(ROWS_PER_CHUNK, rows - base);
+        std::copy_n(c.total.begin(), count, total.begin() + base);
+        std::copy_n(c.core.begin(), count, core.begin() + base);
+        std::copy_n(c.migrations.begin(), count, migrations.begin() + base);
+        std::copy_n(c.memory.begin(), count, memory.begin() + base);
+        for (Slot r = 0; r < count; ++r) {
+            executed[base + r] = c.executed[r].load(std::memory_order_relaxed);
+            state[base + r] = static_cast<uint8_t>(c.state[r].load(std::memory_order_relaxed));
+            arrival[base + r] = Checkpoint::age(c.arrival[r], now);
+            start[base + r] = std::chrono::duration_cast<std::chrono::nanoseconds>(c.start[r].time_since_epoch()).count();
+            finish[base + r] = Checkpoint::age(c.finish[r], now);
+            name_length[base + r] = static_cast<uint32_t>(c.name[r].size());
+            names.insert(names.end(), c.name[r].begin(), c.name[r].end());
+        }
+    }
+
+    out.add(Checkpoint::Section::TableExecuted, std::move(executed));
+    out.add(Checkpoint::Section::TableTotal, std::move(total));
+    out.add(Checkpoint::Section::TableCore, std::move(core));
+    out.add(Checkpoint::Section::TableMigrations, std::move(migrations));
+    out.add(Checkpoint::Section::TableMemory, std::move(memory));
+    out.add(Checkpoint::Section::TableState, std::move(state));
+    out.add(Checkpoint::Section::TableArrival, std::move(arrival));
+    out.add(Checkpoint::Section::TableStart, std::move(start));
+    out.add(Checkpoint::Section::TableFinish, std::move(finish));
+    out.add(Checkpoint::Section::TableNameLength, std::move(name_length));
+    out.add(Checkpoint::Section::TableNames, std::move(names));
+}
+
+bool ProcessTable::load(const Checkpoint::Reader& in, std::chrono::steady_clock::time_point now) {
+    if (!in.has(Checkpoint::Section::TableExecuted)) return false;
+    auto executed = in.section<int32_t>(Checkpoint::Section::TableExecuted);
+    auto total = in.section<int32_t>(Checkpoint::Section::TableTotal);
+    auto core = in.section<int32_t>(Checkpoint::Section::TableCore);
+    auto migrations = in.section<uint32_t>(Checkpoint::Section::TableMigrations);
+    auto memory = in.section<uint64_t>(Checkpoint::Section::TableMemory);
+    auto state = in.section<uint8_t>(Checkpoint::Section::TableState);
+    auto arrival = in.section<int64_t>(Checkpoint::Section::TableArrival);
+    auto start = in.section<int64_t>(Checkpoint::Section::TableStart);
+    auto finish = in.section<int64_t>(Checkpoint::Section::TableFinish);
+    auto name_length = in.section<uint32_t>(Checkpoint::Section::TableNameLength);
+    auto names = in.section<char>(Checkpoint::Section::TableNames);
+
+    size_t rows = executed.size();
+    if (rows > size_t(ROWS_PER_CHUNK) * MAX_CHUNKS) return false;
+    for (size_t column : { total.size(), core.size(), migrations.size(), memory.size(), state.size(), arrival.size(), start.size(), finish.size(), name_length.size() }) {
+        if (column != rows) return false;
+    }
+    uint64_t name_bytes = 0;
+    for (uint32_t length : name_length) {
+        name_bytes += length;
+    }
+    if (name_bytes != names.size()) return false;
+    for (uint8_t s : state) {
+        if (s > static_cast<uint8_t>(State::Rejected)) return false;
+    }
+
+    std::lock_guard<std::mutex> lock(append_mtx_);
+    size_.store(0, std::memory_order_release);
+
+    // All names go into one arena block; later names start a fresh one
+    names_.clear();
+    names_.emplace_back(new char[std::max<size_t>(names.size(), 1)]);
+    std::memcpy(names_.back().get(), names.data(), names.size());
+    names_used_ = NAME_BLOCK_SIZE;
+    const char* name = names_.back().get();
+
+    for (size_t base = 0; base < rows; base += ROWS_PER_CHUNK) {
+        Slot index = static_cast<Slot>(base / ROWS_PER_CHUNK);
+        if (!chunks_[index].load(std::memory_order_relaxed)) {
+            chunks_[index].store(new Chunk(), std::memory_order_release);
+        }
+        Chunk& c = *chunks_[index].load(std::memory_order_relaxed);
+        size_t count = std::min<size_t>(ROWS_PER_CHUNK, rows - base);
+        std::copy_n(total.begin() + base, count, c.total.begin());
+        std::copy_n(core.begin() + base, count, c.core.begin());
+        std::copy_n(migrations.begin() + base, count, c.migrations.begin());
+        std::copy_n(memory.begin() + base, count, c.memory.begin());
+        for (size_t r = 0; r < count; ++r) {
+            c.executed[r].store(executed[base + r], std::memory_order_relaxed);
+            c.state[r].store(static_cast<State>(state[base + r]), std::memory_order_relaxed);
+            c.arrival[r] = Checkpoint::instant(arrival[base + r], now);
+            c.start[r] = std::chrono::system_clock::time_point(std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::nanoseconds(start[base + r])));
+            c.finish[r] = Checkpoint::instant(finish[base + r], now);
+            c.name[r] = std::string_view(name, name_length[base + r]);
+            name += name_length[base + r];
+        }
+    }
+
+    size_.store(static_cast<Slot>(rows), std::memory_order_release);
+    return true;
+}
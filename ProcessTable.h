@@ -0,0 +1,85 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <vector>
+#include "Checkpoint.h"
+
+// Every process ever submitted, stored as struct-of-arrays columns. Rows
+// live in fixed 64K-row chunks that never move, so a Process can keep
+// references to its row and readers can scan [0, size()) without a lock
+// while new rows are appended. Names are copied once into an append-only
+// arena. A Process object only carries what a core needs to execute it
+// (bytecode and CPU state); once it retires it is freed and its row is the
+// only record left, about 64 bytes plus the name.
+class ProcessTable {
+public:
+    using Slot = uint32_t;
+
+    enum class State : uint8_t {
+        Submitted, // Created, not yet handed to a scheduler
+        Waiting,   // In the admission backlog, waiting for memory
+        Ready,     // Admitted, waiting for a core
+        Running,
+        Blocked,   // Sleeping in the scheduler's timer wheel
+        Finished,
+        Rejected   // Larger than all of memory
+    };
+
+    static constexpr Slot ROWS_PER_CHUNK = 1u << 16;
+    static constexpr Slot MAX_CHUNKS = 1024; // 64M rows
+
+    struct Chunk {
+        std::array<std::atomic<int>, ROWS_PER_CHUNK> executed;
+        std::array<int, ROWS_PER_CHUNK> total;
+        std::array<int, ROWS_PER_CHUNK> core;
+        std::array<uint32_t, ROWS_PER_CHUNK> migrations; // Dispatches on a core other than the previous one
+        std::array<size_t, ROWS_PER_CHUNK> memory;
+        std::array<std::atomic<State>, ROWS_PER_CHUNK> state;
+        std::array<std::chrono::steady_clock::time_point, ROWS_PER_CHUNK> arrival;
+        std::array<std::chrono::system_clock::time_point, ROWS_PER_CHUNK> start;
+        std::array<std::chrono::steady_clock::time_point, ROWS_PER_CHUNK> finish;
+        std::array<std::string_view, ROWS_PER_CHUNK> name;
+    };
+
+    // Appends a row and returns its slot; the process id is slot + 1.
+    static Slot add(std::string_view name, int total_commands, size_t memory);
+    // Rows published so far
+    static Slot size() { return size_.load(std::memory_order_acquire); }
+
+    static Chunk& chunk(Slot slot) { return *chunks_[slot / ROWS_PER_CHUNK].load(std::memory_order_acquire); }
+    static Slot row(Slot slot) { return slot % ROWS_PER_CHUNK; }
+
+    static std::string_view name(Slot slot) { return chunk(slot).name[row(slot)]; }
+    static int executed(Slot slot) { return chunk(slot).executed[row(slot)].load(std::memory_order_relaxed); }
+    static int total(Slot slot) { return chunk(slot).total[row(slot)]; }
+    static uint32_t migrations(Slot slot) { return chunk(slot).migrations[row(slot)]; }
+    static State state(Slot slot) { return chunk(slot).state[row(slot)].load(std::memory_order_relaxed); }
+    static void setState(Slot slot, State state) { chunk(slot).state[row(slot)].store(state, std::memory_order_relaxed); }
+
+    struct Totals {
+        size_t processes[7] = {}; // Indexed by State
+        uint64_t executed = 0;    // Instructions retired by running and finished processes
+        uint64_t total = 0;       // Instructions those processes consist of
+    };
+    // One linear pass over every column chunk.
+    static Totals totals();
+
+    // Checkpoint support. save copies rows [0, size()) column by column.
+    // load replaces the whole table; nothing may append rows or run a
+    // process meanwhile. It fails without changes if the columns disagree.
+    static void save(Checkpoint::Writer& out, std::chrono::steady_clock::time_point now);
+    static bool load(const Checkpoint::Reader& in, std::chrono::steady_clock::time_point now);
+
+private:
+    static std::atomic<Chunk*> chunks_[MAX_CHUNKS];
+    static std::atomic<Slot> size_;
+    static std::mutex append_mtx_;                     // Appenders only; readers never lock
+    static std::vector<std::unique_ptr<char[]>> names_; // Name arena blocks
+    static size_t names_used_;                          // Bytes used in the last block
+};
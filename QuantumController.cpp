@@ -0,0 +1,118 @@
+#include "QuantumController.h"
+#include <algorithm>
+#include <cmath>
+#include "Metrics.h"
+#include "ReportRenderer.h"
+
+namespace {
+
+double smooth(double average, double sample, bool first) {
+    return first ? sample : average + QuantumController::SMOOTHING * (sample - average);
+}
+
+}
+
+QuantumController::Settings QuantumController::fromConfig(const Config::ConfigParameters& config) {
+    Settings settings;
+    settings.adaptive = config.quantum_mode == "adaptive";
+    settings.target_response_ms = config.target_response_ms;
+    settings.min_quantum = config.quantum_min_cycles;
+    settings.max_quantum = std::max(config.quantum_min_cycles, config.quantum_max_cycles);
+    settings.hysteresis_percent = config.quantum_hysteresis;
+    return settings;
+}
+
+void QuantumController::configure(const Settings& settings) {
+    this->settings = settings;
+    pending = 0;
+}
+
+void QuantumController::setUnits(double per_second) {
+    units_per_second = per_second;
+    primed = false;
+    unit_per_cycle = 0;
+    switch_units.store(0, std::memory_order_relaxed);
+    switches.store(0, std::memory_order_relaxed);
+}
+
+int QuantumController::update(double seconds, size_t ready, int cores, uint64_t busy_units, uint64_t busy_cycles, int current) {
+    bool first_sample = !primed;
+    queued = smooth(queued, static_cast<double>(ready) / std::max(cores, 1), first_sample);
+    if (primed && busy_cycles > last_cycles && busy_units >= last_units) {
+        double sample = static_cast<double>(busy_units - last_units) / static_cast<double>(busy_cycles - last_cycles);
+        unit_per_cycle = smooth(unit_per_cycle, sample, unit_per_cycle == 0);
+    }
+    primed = true;
+    last_units = busy_units;
+    last_cycles = busy_cycles;
+    uint64_t count = switches.exchange(0, std::memory_order_relaxed);
+    uint64_t total = switch_units.exchange(0, std::memory_order_relaxed);
+    if (count > 0) {
+        switch_cost = smooth(switch_cost, static_cast<double>(total) / static_cast<double>(count), switch_cost == 0);
+    }
+    if (unit_per_cycle <= 0) return current; // Nothing has run yet
+
+    double target = settings.target_response_ms * units_per_second / 1000;
+    double longest = queued > 0 ? (target / queued - switch_cost) / unit_per_cycle : settings.max_quantum;
+    double shortest = switch_cost / (MAX_SWITCH_SHARE * unit_per_cycle);
+    int ideal = static_cast<int>(std::lround(std::clamp(std::max(longest, shortest), static_cast<double>(settings.min_quantum), static_cast<double>(settings.max_quantum))));
+
+    // Hysteresis: small moves are ignored, large ones must persist
+    double band = std::max(1.0, current * settings.hysteresis_percent / 100.0);
+    int direction = ideal > current + band ? 1 : ideal < current - band ? -1 : 0;
+    if (direction == 0 || pending * direction < 0) {
+        pending = direction; // Back inside the band, or reversed
+    }
+    else {
+        pending += direction;
+    }
+    if (std::abs(pending) < CONFIRMATIONS && !(current < settings.min_quantum || current > settings.max_quantum)) {
+        return current;
+    }
+
+    pending = 0;
+    ++changed;
+    log.push_back(Change{ seconds, ideal, queued, switch_cost });
+    if (log.size() > HISTORY) {
+        log.pop_front();
+    }
+    return ideal;
+}
+
+void QuantumController::collectMetrics(MetricsWriter& out, int current) const {
+    out.family("csopesy_rr_quantum_cycles", "gauge", "Round-robin time quantum in use.");
+    out.sample("csopesy_rr_quantum_cycles", static_cast<double>(current));
+    out.family("csopesy_rr_quantum_changes_total", "counter", "Times the adaptive controller changed the quantum.");
+    out.sample("csopesy_rr_quantum_changes_total", static_cast<double>(changed));
+    out.family("csopesy_rr_switch_seconds", "gauge", "Smoothed cost of switching a core from a preempted process to the next.");
+    out.sample("csopesy_rr_switch_seconds", switch_cost / units_per_second);
+}
+
+void QuantumController::appendSummary(ReportRenderer& report, int current, size_t entries) const {
+    report.append("Quantum: ");
+    report.appendNumber(current);
+    report.append(settings.adaptive ? " cycles, adaptive " : " cycles, fixed");
+    if (settings.adaptive) {
+        report.appendNumber(settings.min_quantum);
+        report.append("-");
+        report.appendNumber(settings.max_quantum);
+        report.append(" for a ");
+        report.appendNumber(settings.target_response_ms);
+        report.append(" ms response target, ");
+        report.appendNumber(static_cast<long long>(changed));
+        report.append(changed == 1 ? " change" : " changes");
+    }
+    report.append("\n");
+    for (size_t i = log.size() - std::min(entries, log.size()); i < log.size(); ++i) {
+        const Change& change = log[i];
+        report.append("  ");
+        report.appendFixed(change.seconds, 2, 0);
+        report.append(" s: ");
+        report.appendNumber(change.quantum);
+        report.append(" cycles, ");
+        report.appendFixed(change.queued_per_core, 1, 0);
+        report.append(" ready per core, switch ");
+        report.appendFixed(change.switch_cost * 1e6 / units_per_second, 1, 0);
+        report.append(" us\n");
+    }
+}
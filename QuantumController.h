@@ -0,0 +1,90 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include "Config.h"
+
+class MetricsWriter;
+class ReportRenderer;
+
+// Adaptive round-robin time quantum. Every INTERVAL the scheduler reports
+// how many processes are ready and how much time its cores spent per cycle,
+// and the controller picks the quantum between two bounds:
+//
+// - the longest one that still meets the target response time: a process
+//   that becomes ready waits for the quanta and switches of those queued
+//   ahead of it on its core, so bursts with long queues get short quanta;
+// - the shortest one that keeps context switches under MAX_SWITCH_SHARE of
+//   core time, so steady loads with short queues get long quanta.
+//
+// The queue length and switch cost are smoothed, and a new quantum only
+// applies once it has differed from the current one by more than the
+// hysteresis band, in the same direction, CONFIRMATIONS updates in a row.
+//
+// Time is in the scheduler's units: nanoseconds when cores run free, cycles
+// in lockstep (where a switch costs nothing, so only the target applies).
+// Not synchronized, except recordSwitch; the scheduler's lock guards it.
+class QuantumController {
+public:
+    static constexpr int INTERVAL_MS = 50;         // Between updates
+    static constexpr double MAX_SWITCH_SHARE = 0.1;
+    static constexpr double SMOOTHING = 0.25;      // Weight of the newest sample
+    static constexpr int CONFIRMATIONS = 2;
+    static constexpr size_t HISTORY = 256;         // Changes kept for reports
+
+    struct Settings {
+        bool adaptive = false;
+        int target_response_ms = 100;
+        int min_quantum = 1;       // Cycles
+        int max_quantum = 100;
+        int hysteresis_percent = 25;
+    };
+    // quantum-mode, target-response-ms, quantum-min-cycles, quantum-max-cycles, quantum-hysteresis
+    static Settings fromConfig(const Config::ConfigParameters& config);
+
+    // One chosen quantum and what it was chosen from
+    struct Change {
+        double seconds;          // Since the scheduler started
+        int quantum;
+        double queued_per_core;
+        double switch_cost;      // Units per context switch
+    };
+
+    void configure(const Settings& settings); // Keeps the history
+    // How many units make a second; also forgets the busy-time baseline. At start.
+    void setUnits(double units_per_second);
+    bool adaptive() const { return settings.adaptive; }
+
+    // A core switched from a preempted process to the next one in `units`.
+    // Lock-free, for the cores.
+    void recordSwitch(uint64_t units) {
+        switch_units.fetch_add(units, std::memory_order_relaxed);
+        switches.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Returns the quantum to use from now on, given the current one, the
+    // ready processes, and the cores' busy time and cycles so far.
+    int update(double seconds, size_t ready, int cores, uint64_t busy_units, uint64_t busy_cycles, int current);
+
+    const std::deque<Change>& history() const { return log; }
+    uint64_t changes() const { return changed; }
+
+    void collectMetrics(MetricsWriter& out, int current) const;
+    // "Quantum: ..." and the last `entries` changes, oldest first
+    void appendSummary(ReportRenderer& report, int current, size_t entries) const;
+
+private:
+    Settings settings;
+    double units_per_second = 1e9;
+    double queued = 0;          // Smoothed ready processes per core
+    double unit_per_cycle = 0;  // Smoothed; 0 until a cycle has run
+    double switch_cost = 0;     // Smoothed units per switch
+    bool primed = false;        // The busy-time baseline is set
+    uint64_t last_units = 0, last_cycles = 0;
+    int pending = 0;            // Updates in a row the ideal quantum was above (+) or below (-) the band
+    uint64_t changed = 0;
+    std::deque<Change> log;
+    std::atomic<uint64_t> switch_units{ 0 }; // Since the last update
+    std::atomic<uint64_t> switches{ 0 };
+};
@@ -2,7 +2,12 @@
 #include <iostream>
 #include <chrono>
 #include "Config.h"
+#include "Interpreter.h"
+#include "Platform.h"
+#include "ReportRenderer.h"
+#include "Tracer.h"
 #include <algorithm>
+#include <utility>
 
 RR_Scheduler::RR_Scheduler(int cores, int quantum, size_t total_memory)
     : num_cores(cores), time_quantum(quantum), running(false), total_memory(total_memory), used_memory(0), free_memory(total_memory) {}
@@ -19,26 +24,282 @@ void RR_Scheduler::vmstat() const {
 }
 
 void RR_Scheduler::add_process(Process* proc) {
+    add_processes(std::span<Process* const>(&proc, 1));
+}
+
+// Admits a burst of arrivals under one lock acquisition and wakes only as
+// many cores as there is new work for.
+void RR_Scheduler::add_processes(std::span<Process* const> procs) {
+    std::lock_guard<std::mutex> lock(mtx);
+    admit_arrivals(procs);
+    publish_depths();
+}
+
+// Starts a copy of a live process under a new name. The child runs the same
+// program from the beginning and shares the parent's memory copy-on-write
+// when the allocator supports it, so only the pages it writes cost frames.
+bool RR_Scheduler::clone_process(const std::string& parent_name, const std::string& child_name) {
     std::lock_guard<std::mutex> lock(mtx);
-    if (used_memory + proc->memory <= total_memory) {
-        process_queue.push(proc);
-        used_memory += proc->memory;
-        free_memory -= proc->memory;
-        cv.notify_one();
+    Process* parent = find_live(parent_name);
+    if (!parent) return false;
+
+    Process* child = new Process(child_name, *parent);
+    if (memory_manager && pending_processes.empty()) {
+        // Only a child admitted right away shares frames; one that has to
+        // wait in the backlog is allocated its own memory on admission
+        memory_manager->forkProcess(parent->process_id, child->process_id);
     }
-    else {
-        std::cout << "Not enough memory to add process " << proc->name << ".\n";
+    admit_arrivals(std::span<Process* const>(&child, 1));
+    publish_depths();
+    return true;
+}
+
+// Caller holds mtx. A process that has not retired, or nullptr.
+Process* RR_Scheduler::find_live(const std::string& process_name) const {
+    auto named = [&](const Process* proc) { return proc->name == process_name; };
+    if (Process* proc = domains.findIf(named)) return proc;
+    for (std::queue<Process*> queue = pending_processes; !queue.empty(); queue.pop()) {
+        if (named(queue.front())) return queue.front();
+    }
+    Process* blocked = nullptr;
+    sleepers.forEach([&](Process* proc) {
+        if (!blocked && named(proc)) blocked = proc;
+    });
+    return blocked;
+}
+
+// Caller holds mtx. Rejects processes that can never fit, queues the rest for
+// memory; returns how many went straight to the ready queue.
+size_t RR_Scheduler::admit_arrivals(std::span<Process* const> procs) {
+    size_t capacity = memory_manager ? memory_manager->getTotalMemory() : total_memory;
+    size_t admitted = 0;
+    for (Process* proc : procs) {
+        if (proc->memory > capacity) {
+            std::cout << "Not enough memory to add process " << proc->name << ".\n";
+            ProcessTable::setState(proc->slot, ProcessTable::State::Rejected);
+            rejected_count.fetch_add(1, std::memory_order_relaxed);
+            delete proc;
+            continue;
+        }
+        // Nothing jumps ahead of processes already waiting for memory
+        if (!pending_processes.empty() || !admit(proc)) {
+            ProcessTable::setState(proc->slot, ProcessTable::State::Waiting);
+            pending_processes.push(proc);
+        }
+        else {
+            ++admitted;
+        }
+    }
+    return admitted;
+}
+
+// Caller holds mtx. Reserves memory and queues the process in the least
+// loaded domain; false if it does not fit yet.
+bool RR_Scheduler::admit(Process* proc) {
+    bool fits = memory_manager ? memory_manager->allocateProcess(proc->process_id, proc->memory)
+                               : used_memory + proc->memory <= total_memory;
+    if (!fits) return false;
+
+    ProcessTable::setState(proc->slot, ProcessTable::State::Ready);
+    used_memory += proc->memory;
+    free_memory = used_memory < total_memory ? total_memory - used_memory : 0;
+    if (affinity.preferring()) {
+        proc->off_core_since = affinity_now();
+    }
+    make_ready(domains.leastLoaded(), proc);
+    return true;
+}
+
+// Appends a process to a domain's ready queue and wakes one of its cores.
+// Takes the domain's lock, so the caller holds mtx or no lock at all.
+void RR_Scheduler::make_ready(SchedulerDomains::Domain& domain, Process* proc) {
+    std::lock_guard<std::mutex> lock(domain.mtx);
+    domain.ready.push(proc);
+    publish_domain(domain);
+    notify_domain(domain, 1);
+}
+
+// Caller holds domain.mtx. Wakes enough of the domain's cores for `count`
+// newly queued processes.
+void RR_Scheduler::notify_domain(SchedulerDomains::Domain& domain, size_t count) {
+    for (size_t i = 0; i < count && !domain.idle_cores.empty(); ++i) {
+        pool->post(domain.idle_cores.front());
+        domain.idle_cores.pop_front();
+    }
+    if (count >= domain.cores.size()) {
+        domain.cv.notify_all();
+        return;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        domain.cv.notify_one();
+    }
+}
+
+// Caller holds mtx. Moves queued processes between domains; see SchedulerDomains::balance.
+void RR_Scheduler::balance(bool idle_only) {
+    domains.balance(balance_threshold, idle_only, [this](SchedulerDomains::Domain& domain, size_t count) { notify_domain(domain, count); });
+}
+
+// Called by a core whose domain ran out of work: asks timer_worker for a
+// balancing pass that fills idle cores from the other domains.
+void RR_Scheduler::request_balance() {
+    if (domains.size() > 1 && !balance_wanted.exchange(true, std::memory_order_relaxed)) {
+        timer_cv.notify_one();
+    }
+}
+
+// Caller holds mtx. Admits waiting processes in arrival order while they fit.
+void RR_Scheduler::admit_pending() {
+    while (!pending_processes.empty() && admit(pending_processes.front())) {
+        pending_processes.pop();
+    }
+    publish_depths();
+}
+
+// Caller holds mtx. Moves a finished process off its core and frees its memory.
+// The Process object is deleted; its table row remains as the record.
+void RR_Scheduler::retire(Process* proc) {
+    proc->finish_time = std::chrono::steady_clock::now();
+    latency.turnaround.record(std::chrono::duration_cast<std::chrono::nanoseconds>(proc->finish_time - proc->arrival_time).count());
+    latency.waiting.record(std::chrono::duration_cast<std::chrono::nanoseconds>(proc->waiting_time).count());
+    TRACE_EVENT(Tracer::Event::Finish, proc->process_id);
+    leave_core(proc);
+    finished_processes.push_back(proc->slot);
+    ProcessTable::setState(proc->slot, ProcessTable::State::Finished);
+    if (memory_manager) {
+        memory_manager->deallocateProcess(proc->process_id);
+    }
+    used_memory -= proc->memory;
+    free_memory = used_memory < total_memory ? total_memory - used_memory : 0;
+    delete proc;
+    admit_pending();
+}
+
+// Caller holds mtx. Takes a process off the running list of its core's domain
+// and gives the core back to its CPU group.
+void RR_Scheduler::leave_core(Process* proc) {
+    SchedulerDomains::Domain& domain = domains.ofCore(proc->core_id);
+    std::lock_guard<std::mutex> lock(domain.mtx);
+    domain.running.remove(proc);
+    groups.leave(proc->group);
+    if (affinity.preferring()) {
+        proc->off_core_since = affinity_now();
+    }
+    publish_domain(domain);
+}
+
+// Caller holds mtx. Takes a process that executed SLEEP off its core and
+// parks it in the timer wheel until `tick` + its sleep ticks. Its memory
+// stays allocated.
+void RR_Scheduler::block(Process* proc, uint64_t tick) {
+    TRACE_EVENT(Tracer::Event::Block, proc->process_id, proc->cpu.sleep_ticks);
+    leave_core(proc);
+    ProcessTable::setState(proc->slot, ProcessTable::State::Blocked);
+    bool first = sleepers.empty();
+    if (first) {
+        sleepers.advance(tick, woken); // An idle wheel catches up in one step
+    }
+    sleepers.schedule(proc, tick + static_cast<uint64_t>(proc->cpu.sleep_ticks));
+    proc->cpu.sleep_ticks = 0;
+    if (!pending_processes.empty() && memory_manager && memory_manager->admitsByWorkingSet()) {
+        admit_pending(); // A sleeping process's working set shrinks, which may let a waiting one in
+    }
+    publish_depths();
+    if (first) {
+        timer_cv.notify_one();
+    }
+}
+
+// Caller holds mtx. Turns the timer wheel to `tick` and moves every process
+// whose sleep ended to the back of the ready queue of the domain it last ran in.
+void RR_Scheduler::wake_sleepers(uint64_t tick) {
+    woken.clear();
+    sleepers.advance(tick, woken);
+    if (woken.empty()) return;
+
+    auto now = std::chrono::steady_clock::now();
+    for (Process* proc : woken) {
+        proc->markReady(now);
+        ProcessTable::setState(proc->slot, ProcessTable::State::Ready);
+        make_ready(domains.home(proc->core_id), proc);
+        TRACE_EVENT(Tracer::Event::Wake, proc->process_id);
+    }
+    publish_depths();
+}
+
+// Free-running ticks since start(), each sleep_tick long.
+uint64_t RR_Scheduler::current_tick() const {
+    return static_cast<uint64_t>((std::chrono::steady_clock::now() - start_time) / sleep_tick);
+}
+
+// Time in SoftAffinity's units: the cycle in lockstep, steady nanoseconds otherwise
+uint64_t RR_Scheduler::affinity_now() const {
+    if (clock_settings.lockstep) {
+        return clock ? clock->now() : start_cycle;
+    }
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Turns the timer wheel once per tick while anything sleeps, starts each CPU
+// quota period and, with more than one domain, balances them every
+// balance_interval and whenever a core runs dry. Lockstep mode does all of
+// it from lockstep_step instead, in cycles.
+void RR_Scheduler::timer_worker() {
+    std::unique_lock<std::mutex> lock(mtx);
+    auto next_balance = std::chrono::steady_clock::now() + balance_interval;
+    auto next_retune = std::chrono::steady_clock::now() + std::chrono::milliseconds(QuantumController::INTERVAL_MS);
+    while (running) {
+        bool balancing = domains.size() > 1;
+        bool quotas = groups.hasQuota();
+        bool adapting = quantum_control.adaptive();
+        if (sleepers.empty() && !balancing && !quotas && !adapting) {
+            timer_cv.wait(lock, [&] { return !running || !sleepers.empty(); });
+            continue;
+        }
+        auto deadline = std::chrono::steady_clock::time_point::max();
+        if (balancing) {
+            deadline = next_balance;
+        }
+        if (quotas) {
+            deadline = std::min(deadline, std::chrono::steady_clock::time_point(std::chrono::nanoseconds(groups.periodEnd())));
+        }
+        if (adapting) {
+            deadline = std::min(deadline, next_retune);
+        }
+        if (!sleepers.empty()) {
+            deadline = std::min(deadline, start_time + sleep_tick * static_cast<int64_t>(sleepers.now() + 1));
+        }
+        timer_cv.wait_until(lock, deadline);
+        wake_sleepers(current_tick());
+        if (quotas && groups.refill(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count()))) {
+            release_groups();
+        }
+        if (adapting && std::chrono::steady_clock::now() >= next_retune) {
+            retune_quantum(std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count());
+            next_retune = std::chrono::steady_clock::now() + std::chrono::milliseconds(QuantumController::INTERVAL_MS);
+        }
+        if (!balancing) continue;
+
+        bool wanted = balance_wanted.exchange(false, std::memory_order_relaxed);
+        auto now = std::chrono::steady_clock::now();
+        if (now >= next_balance) {
+            balance(false);
+            next_balance = now + balance_interval;
+        }
+        else if (wanted) {
+            balance(true);
+        }
     }
 }
 
 size_t RR_Scheduler::getIdleTicks() const {
     std::lock_guard<std::mutex> lock(mtx);
-    return process_queue.empty() ? 1 : 0; // Simulate idle tick when queue is empty
+    return domains.depth() == 0 ? 1 : 0; // Simulate idle tick when queue is empty
 }
 
 size_t RR_Scheduler::getActiveTicks() const {
     std::lock_guard<std::mutex> lock(mtx);
-    return running_processes.size(); // Active ticks are equivalent to running processes
+    return domains.runningCount(); // Active ticks are equivalent to running processes
 }
 
 size_t RR_Scheduler::getTotalTicks() const {
@@ -48,86 +309,503 @@ size_t RR_Scheduler::getTotalTicks() const {
 
 
 void RR_Scheduler::start() {
+    if (running || timer_thread.joinable()) {
+        stop(); // Starting again under live cores would replace their threads, clock and pool
+    }
     running = true;
     start_time = std::chrono::steady_clock::now(); // Record the start time
-    for (int i = 0; i < num_cores; ++i) {
-        cpu_threads.emplace_back(&RR_Scheduler::cpu_worker, this, i);
+    core_stats.resize(num_cores);
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        domains.partition(num_cores, domain_spec, affinity_layout);
+    }
+    // Group usage is in cycles in lockstep and in nanoseconds otherwise
+    if (clock_settings.lockstep) {
+        groups.setPeriod(std::max<uint64_t>(1, static_cast<uint64_t>(clock_settings.hz * quota_period.count() / 1000)), clock_settings.hz);
+    }
+    else {
+        groups.setPeriod(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(quota_period).count()), 1e9);
+    }
+    quantum_control.setUnits(clock_settings.lockstep ? clock_settings.hz : 1e9);
+    affinity.setUnits(clock_settings.lockstep ? clock_settings.hz : 1e9);
+    next_balance_cycle = 0;
+    next_quantum_cycle = 0;
+    cores_ready = 0;
+    sleepers.rebase(clock_settings.lockstep ? start_cycle : current_tick()); // Sleepers from before a restart keep their remaining ticks
+    if (coroutine_cores && !clock_settings.lockstep) {
+        // Lockstep cores block in a barrier, so they always get threads of their own
+        pool = std::make_unique<CorePool>(host_threads);
+        for (int i = 0; i < num_cores; ++i) {
+            pool->spawn(core_task(i));
+        }
+    }
+    else if (clock_settings.lockstep) {
+        core_process.assign(num_cores, nullptr);
+        core_quantum_used.assign(num_cores, 0);
+        clock = std::make_unique<CycleClock>(num_cores, clock_settings, start_cycle, [this](uint64_t cycle) { return lockstep_step(cycle); });
+    }
+    for (int i = 0; !pool && i < num_cores; ++i) {
+        cpu_threads.emplace_back(clock ? &RR_Scheduler::lockstep_worker : &RR_Scheduler::cpu_worker, this, i);
+    }
+    // Wait until every core has set up its per-core data
+    while (cores_ready.load() < num_cores) {
+        std::this_thread::yield();
+    }
+    if (!clock_settings.lockstep) {
+        timer_thread = std::thread(&RR_Scheduler::timer_worker, this); // Reads core_stats, so only once the cores have made theirs
     }
     //std::cout << "Scheduler started with " << num_cores << " cores.\n";
 }
 
 void RR_Scheduler::stop() {
     running = false;
-    cv.notify_all();
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        for (size_t i = 0; i < domains.size(); ++i) {
+            // Waiting and parked coroutine cores see running == false and return
+            SchedulerDomains::Domain& domain = domains[i];
+            std::lock_guard<std::mutex> domain_lock(domain.mtx);
+            notify_domain(domain, domain.idle_cores.size() + domain.cores.size());
+        }
+        timer_cv.notify_all();
+    }
+    if (timer_thread.joinable()) {
+        timer_thread.join();
+    }
     for (std::thread& t : cpu_threads) {
         if (t.joinable()) {
             t.join();
         }
     }
+    if (pool) {
+        pool->join();
+        pool.reset();
+    }
+    cpu_threads.clear();
+    if (clock) {
+        start_cycle = clock->now();
+    }
+    std::lock_guard<std::mutex> lock(mtx);
+    reclaim_cores();
     //std::cout << "Scheduler stopped.\n";
 }
 
+// Caller holds mtx, with the cores stopped. Puts the processes left on a core
+// and those batched onto one back at the head of their domain's ready queue,
+// so after a stop every live process is in a queue or the timer wheel.
+void RR_Scheduler::reclaim_cores() {
+    auto now = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < domains.size(); ++i) {
+        SchedulerDomains::Domain& domain = domains[i];
+        std::lock_guard<std::mutex> lock(domain.mtx);
+        std::vector<Process*> reclaimed;
+        for (Process* proc : domain.running) {
+            proc->markReady(now);
+            ProcessTable::setState(proc->slot, ProcessTable::State::Ready);
+            reclaimed.push_back(proc);
+        }
+        domain.running.clear();
+        for (auto& batch : domain.batches) {
+            reclaimed.insert(reclaimed.end(), batch.begin(), batch.end());
+            batch.clear();
+        }
+        domain.batched = 0;
+        if (reclaimed.empty()) continue;
+
+        for (Process* proc : reclaimed) {
+            groups.leave(proc->group);
+        }
+        // Backwards, so each group's head keeps the order they were taken in
+        for (auto it = reclaimed.rbegin(); it != reclaimed.rend(); ++it) {
+            domain.ready.pushFront(*it);
+        }
+        publish_domain(domain);
+    }
+    std::fill(core_process.begin(), core_process.end(), nullptr);
+}
+
+// Caller holds the lock of this core's domain through `lock`. Returns this
+// core's next process. When its batch is empty it refills it with up to
+// `batch` processes from the domain's ready queue, never more than an even
+// share per core so idle cores are not starved. A domain whose queued
+// processes all belong to throttled CPU groups counts as empty until the
+// quota period ends. Returns nullptr once the scheduler stops.
+Process* RR_Scheduler::dispatch(int core_id, int batch, std::unique_lock<std::mutex>& lock) {
+    SchedulerDomains::Domain& domain = domains.ofCore(core_id);
+    if (domains.batchOf(core_id).empty()) {
+        if (domain.ready.empty()) {
+            request_balance();
+        }
+        domain.cv.wait(lock, [&] { return domain.ready.runnable(groups) || !running; });
+    }
+    if (!running) return nullptr;
+    return take_next(core_id, batch);
+}
+
+// Caller holds the lock of this core's domain. Non-blocking part of dispatch:
+// nullptr when neither this core's batch nor the domain's ready queue has a
+// process it may run.
+Process* RR_Scheduler::take_next(int core_id, int batch) {
+    SchedulerDomains::Domain& domain = domains.ofCore(core_id);
+    std::deque<Process*>& local = domains.batchOf(core_id);
+    if (local.empty()) {
+        size_t share = std::max<size_t>(1, domain.ready.size() / domain.cores.size());
+        uint64_t now = affinity.preferring() ? affinity_now() : 0;
+        for (size_t take = std::min(static_cast<size_t>(std::max(batch, 1)), share); take > 0; --take) {
+            Process* proc = domain.ready.pop(groups, affinity, core_id, now);
+            if (!proc) break;
+            local.push_back(proc);
+            ++domain.batched;
+        }
+    }
+    if (local.empty()) return nullptr;
+
+    Process* proc = local.front();
+    local.pop_front();
+    --domain.batched;
+    start_on_core(proc, core_id);
+    publish_domain(domain);
+
+    // The process in line after this one can be paged in while this one runs
+    Process* next = !local.empty() ? local.front() : domain.ready.peek(groups);
+    if (next && memory_manager) {
+        memory_manager->prepareDispatch(next->process_id, next->memory * next->executed_commands.load(std::memory_order_relaxed) / next->total_commands);
+    }
+    return proc;
+}
+
+// Caller holds the lock of this core's domain. Places a process taken off
+// its ready queue on a core.
+void RR_Scheduler::start_on_core(Process* proc, int core_id) {
+    affinity.place(*proc, core_id, *core_stats[core_id]);
+    proc->core_id = core_id;
+    proc->start_time = std::chrono::system_clock::now();
+    domains.ofCore(core_id).running.push_back(proc);
+    ProcessTable::setState(proc->slot, ProcessTable::State::Running);
+
+    auto now = std::chrono::steady_clock::now();
+    if (proc->markDispatched(now)) {
+        latency.response.record(std::chrono::duration_cast<std::chrono::nanoseconds>(now - proc->arrival_time).count());
+    }
+    core_stats[core_id]->dispatches.fetch_add(1, std::memory_order_relaxed);
+    TRACE_EVENT(Tracer::Event::Dispatch, proc->process_id);
+}
+
+// Caller holds domain.mtx. Puts a preempted process back at the tail of the
+// ready queue of the domain it ran in without going through admission: its
+// memory is still held.
+void RR_Scheduler::requeue(Process* proc, SchedulerDomains::Domain& domain) {
+    TRACE_EVENT(Tracer::Event::Preempt, proc->process_id);
+    domain.running.remove(proc);
+    groups.leave(proc->group);
+    proc->markReady(std::chrono::steady_clock::now());
+    if (affinity.preferring()) {
+        proc->off_core_since = affinity_now();
+    }
+    ProcessTable::setState(proc->slot, ProcessTable::State::Ready);
+    domain.ready.push(proc);
+    TRACE_EVENT(Tracer::Event::Requeue, proc->process_id);
+    publish_domain(domain);
+}
+
+// Runs first on each core thread or coroutine.
+CoreStats* RR_Scheduler::setup_core(int core_id) {
+    // Pin before allocating per-core data so it is placed on this core's NUMA
+    // node. Coroutine cores move between pool threads and are never pinned.
+    Affinity::HostCpu host = pool ? Affinity::HostCpu{ -1, -1 } : Affinity::placeCore(core_id, affinity_layout);
+    if (host.cpu != -1 && !Affinity::pinCurrentThread(host.cpu)) {
+        host = { -1, -1 };
+    }
+    if (!core_stats[core_id]) {
+        core_stats[core_id].reset(new CoreStats()); // Kept across restarts, so counters carry on
+    }
+    CoreStats* stats = core_stats[core_id].get();
+    stats->host_cpu = host.cpu;
+    stats->numa_node = host.numa_node;
+    cores_ready.fetch_add(1);
+    Tracer::setThreadCore(core_id);
+    return stats;
+}
+
 void RR_Scheduler::cpu_worker(int core_id) {
-    while (running) {
-        Process* proc = nullptr;
+    CoreStats* stats = setup_core(core_id);
 
+    Config::Reader config_reader; // Cached snapshot, refreshed only after a reload
+    SchedulerDomains::Domain& domain = domains.ofCore(core_id);
+    Process* proc = nullptr;
+    auto slice_end = std::chrono::steady_clock::now();
+    for (;;) {
+        if (proc && (proc->executed_commands.load(std::memory_order_relaxed) >= proc->total_commands || proc->cpu.sleep_ticks > 0)) {
+            // Retiring and blocking touch memory and the timer wheel, which the scheduler's lock guards
+            std::lock_guard<std::mutex> lock(mtx);
+            if (proc->executed_commands.load(std::memory_order_relaxed) >= proc->total_commands) {
+                retire(proc);
+            }
+            else {
+                block(proc, current_tick());
+            }
+            proc = nullptr;
+        }
         {
-            std::unique_lock<std::mutex> lock(mtx);
-            cv.wait(lock, [&] { return !process_queue.empty() || !running; });
+            std::unique_lock<std::mutex> lock(domain.mtx);
+            // Requeuing the previous process and dispatching the next share one lock acquisition
+            if (proc) {
+                requeue(proc, domain);
+                domain.cv.notify_one();
+            }
+            bool preempted = proc != nullptr;
+            proc = dispatch(core_id, config_reader.get().dispatch_batch, lock);
+            if (preempted && proc) {
+                // Requeue, lock hand-offs and dispatch: the cost of a context switch
+                quantum_control.recordSwitch(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - slice_end).count());
+            }
+        }
+        if (!proc) break;
 
-            if (!running && process_queue.empty()) break;
+        auto busy_since = std::chrono::steady_clock::now();
 
-            proc = process_queue.front();
-            process_queue.pop();
-            proc->core_id = core_id;
-            proc->start_time = std::chrono::system_clock::now();
-            running_processes.push_back(proc);
-        }
+        // The core owns proc for the whole quantum, so execution needs no lock;
+        // progress is published through proc->executed_commands.
+        const Config::ConfigParameters& config = config_reader.get();
+        const int delay_ms = (int)(config.delay_per_exec * 1000);
+        const int quantum = time_quantum.load(std::memory_order_relaxed);
 
-        int remaining_commands = proc->total_commands - proc->executed_commands;
-        int commands_to_execute = std::min(time_quantum, remaining_commands);
         int executed_in_quantum = 0;
-        while (commands_to_execute > 0 && proc->executed_commands < proc->total_commands) {
-            {
-                std::lock_guard<std::mutex> lock(mtx);
+        while (running && proc->cpu.sleep_ticks == 0 && proc->executed_commands.load(std::memory_order_relaxed) < proc->total_commands) {
+            if (memory_manager) {
+                // Touch the page under the current position of the process
+                memory_manager->access(proc->process_id, proc->memory * proc->executed_commands.load(std::memory_order_relaxed) / proc->total_commands,
+                    std::exchange(proc->cpu.stored, 0) != 0);
+            }
+            int step = std::min(config.quantum_cycles, quantum - executed_in_quantum); // Steps never overrun the quantum
+            int cycles = proc->stall_cycles > 0 ? SoftAffinity::stall(*proc, step, *stats) : Interpreter::run(*proc, step);
+            executed_in_quantum += cycles;
+            stats->busy_cycles.fetch_add(cycles, std::memory_order_relaxed);
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(delay_ms)); // Simulated command execution time change this to delays per exec
+
+            // Account busy time per step so utilization and group usage stay current
+            auto now = std::chrono::steady_clock::now();
+            uint64_t busy = std::chrono::duration_cast<std::chrono::nanoseconds>(now - busy_since).count();
+            stats->busy_nanoseconds.fetch_add(busy, std::memory_order_relaxed);
+            groups.charge(proc->group, busy);
+            busy_since = now;
+
+            if (executed_in_quantum >= quantum || groups.throttled(proc->group)) {
+                break; // Exit the loop to re-add the process to the queue
+            }
+        }
+        slice_end = busy_since;
+    }
+}
+
+// Coroutine variant of cpu_worker. Instead of blocking its host thread the
+// core suspends: in WaitForWork while there is nothing to run, on a pool
+// timer for delay-per-exec, and by yielding when it has run for a full
+// CorePool::TIME_SLICE without a delay.
+CoreTask RR_Scheduler::core_task(int core_id) {
+    CoreStats* stats = setup_core(core_id);
+
+    Config::Reader config_reader; // Cached snapshot, refreshed only after a reload
+    auto slice_start = std::chrono::steady_clock::now(); // Last time this core got a host thread
+    SchedulerDomains::Domain& domain = domains.ofCore(core_id);
+    Process* proc = nullptr;
+    auto slice_end = std::chrono::steady_clock::now();
+    for (;;) {
+        Tracer::setThreadCore(core_id); // Each resumption may be on a different host thread
+        if (proc && (proc->executed_commands.load(std::memory_order_relaxed) >= proc->total_commands || proc->cpu.sleep_ticks > 0)) {
+            std::lock_guard<std::mutex> lock(mtx);
+            if (proc->executed_commands.load(std::memory_order_relaxed) >= proc->total_commands) {
+                retire(proc);
+            }
+            else {
+                block(proc, current_tick());
+            }
+            proc = nullptr;
+        }
+        {
+            std::lock_guard<std::mutex> lock(domain.mtx);
+            bool preempted = proc != nullptr;
+            if (proc) {
+                requeue(proc, domain);
+                notify_domain(domain, 1);
+            }
+            proc = running ? take_next(core_id, config_reader.get().dispatch_batch) : nullptr;
+            if (preempted && proc) {
+                quantum_control.recordSwitch(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - slice_end).count());
+            }
+        }
+        if (!proc) {
+            if (!running) break;
+            co_await WaitForWork{ *this, core_id };
+            slice_start = std::chrono::steady_clock::now();
+            continue;
+        }
+
+        auto busy_since = std::chrono::steady_clock::now();
+        const Config::ConfigParameters& config = config_reader.get();
+        const int delay_ms = (int)(config.delay_per_exec * 1000);
+        const int quantum = time_quantum.load(std::memory_order_relaxed);
 
-                proc->executed_commands += Config::GetConfigParameters().quantum_cycles; // time quantum
-                executed_in_quantum += Config::GetConfigParameters().quantum_cycles; // time quantum
-                if (proc->executed_commands >= proc->total_commands) {
-                    proc->executed_commands = proc->total_commands;
-                }
-                //  proc->displayProcessInfo();
+        int executed_in_quantum = 0;
+        while (running && proc->cpu.sleep_ticks == 0 && proc->executed_commands.load(std::memory_order_relaxed) < proc->total_commands) {
+            if (memory_manager) {
+                // Touch the page under the current position of the process
+                memory_manager->access(proc->process_id, proc->memory * proc->executed_commands.load(std::memory_order_relaxed) / proc->total_commands,
+                    std::exchange(proc->cpu.stored, 0) != 0);
+            }
+            int step = std::min(config.quantum_cycles, quantum - executed_in_quantum);
+            int cycles = proc->stall_cycles > 0 ? SoftAffinity::stall(*proc, step, *stats) : Interpreter::run(*proc, step);
+            executed_in_quantum += cycles;
+            stats->busy_cycles.fetch_add(cycles, std::memory_order_relaxed);
 
+            if (delay_ms > 0) {
+                co_await pool->sleepFor(std::chrono::milliseconds(delay_ms));
+                Tracer::setThreadCore(core_id);
+                slice_start = std::chrono::steady_clock::now();
             }
-            std::this_thread::sleep_for(std::chrono::seconds(1));
 
-            std::this_thread::sleep_for(std::chrono::milliseconds((int)(Config::GetConfigParameters().delay_per_exec * 1000))); // Simulated command execution time change this to delays per exec
+            auto now = std::chrono::steady_clock::now();
+            uint64_t busy = std::chrono::duration_cast<std::chrono::nanoseconds>(now - busy_since).count();
+            stats->busy_nanoseconds.fetch_add(busy, std::memory_order_relaxed);
+            groups.charge(proc->group, busy);
+            busy_since = now;
 
-            if (executed_in_quantum >= time_quantum) {
+            if (executed_in_quantum >= quantum || groups.throttled(proc->group)) {
                 break; // Exit the loop to re-add the process to the queue
             }
+            if (now - slice_start >= CorePool::TIME_SLICE) {
+                co_await pool->yield(); // Time in the pool's ready queue is not busy time
+                Tracer::setThreadCore(core_id);
+                busy_since = slice_start = std::chrono::steady_clock::now();
+            }
         }
+        slice_end = busy_since;
+    }
+}
 
-        if (proc->executed_commands < proc->total_commands) {
-            add_process(proc); // Re-add process if it's not completed
-            std::lock_guard<std::mutex> lock(mtx);
-            running_processes.remove(proc);
+bool RR_Scheduler::WaitForWork::await_suspend(std::coroutine_handle<> handle) {
+    SchedulerDomains::Domain& domain = scheduler.domains.ofCore(core_id);
+    std::lock_guard<std::mutex> lock(domain.mtx);
+    // Checked again under the lock: an admission since take_next would otherwise be missed
+    if (domain.ready.runnable(scheduler.groups) || !scheduler.running) return false;
+    domain.idle_cores.push_back(handle);
+    scheduler.request_balance();
+    return true;
+}
+
+// Core thread in lockstep mode. Between barriers the core only runs the
+// process the step assigned it, up to the end of its quantum, and charges
+// the cycles to its CPU group; everything else happens in lockstep_step.
+void RR_Scheduler::lockstep_worker(int core_id) {
+    CoreStats* stats = setup_core(core_id);
+    const int ticks = static_cast<int>(clock->ticksPerSync());
+
+    while (clock->sync()) {
+        Process* proc = core_process[core_id];
+        if (!proc) continue;
+        auto busy_since = std::chrono::steady_clock::now();
+        int budget = std::min(ticks, std::max(1, time_quantum - core_quantum_used[core_id]));
+        int cycles = proc->stall_cycles > 0 ? SoftAffinity::stall(*proc, budget, *stats) : Interpreter::run(*proc, budget);
+        core_quantum_used[core_id] += cycles;
+        stats->busy_cycles.fetch_add(cycles, std::memory_order_relaxed);
+        groups.charge(proc->group, static_cast<uint64_t>(cycles));
+        stats->busy_nanoseconds.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - busy_since).count(), std::memory_order_relaxed);
+    }
+}
+
+// Barrier completion step, run while every core waits: admits the arrivals
+// due by `cycle`, then settles and refills each core in core order. The
+// outcome depends only on the cycle count, so runs with the same input
+// produce the same schedule. Returns false to stop the clock.
+bool RR_Scheduler::lockstep_step(uint64_t cycle) {
+    std::lock_guard<std::mutex> lock(mtx);
+    if (!running || (stop_cycle != 0 && cycle >= stop_cycle)) return false;
+
+    if (arrival_source) {
+        arrivals.clear();
+        arrival_source(cycle, arrivals);
+        admit_arrivals(arrivals);
+    }
+    wake_sleepers(cycle);
+    groups.refill(cycle);
+    if (quantum_control.adaptive() && cycle >= next_quantum_cycle) {
+        next_quantum_cycle = cycle + std::max<uint64_t>(1, static_cast<uint64_t>(clock_settings.hz * QuantumController::INTERVAL_MS / 1000));
+        retune_quantum(static_cast<double>(cycle) / clock_settings.hz);
+    }
+    if (domains.size() > 1) {
+        // Idle cores are filled every step, loads evened out every balance_interval of emulated time
+        bool due = cycle >= next_balance_cycle;
+        if (due) {
+            next_balance_cycle = cycle + std::max<uint64_t>(1, static_cast<uint64_t>(clock_settings.hz * balance_interval.count() / 1000));
         }
-        else {
-            std::lock_guard<std::mutex> lock(mtx);
-            running_processes.remove(proc);
-            finished_processes.push_back(proc);
-            used_memory -= proc->memory;
-            free_memory += proc->memory;
+        balance(!due);
+    }
+
+    int own_core = Tracer::threadCore();
+    for (int core_id = 0; core_id < num_cores; ++core_id) {
+        Tracer::setThreadCore(core_id); // Events below belong on this core's track
+        Process*& proc = core_process[core_id];
+        if (proc && proc->executed_commands.load(std::memory_order_relaxed) >= proc->total_commands) {
+            retire(proc);
+            proc = nullptr;
+        }
+        else if (proc && proc->cpu.sleep_ticks > 0) {
+            block(proc, cycle);
+            proc = nullptr;
+        }
+        {
+            // Each core takes from its own domain
+            SchedulerDomains::Domain& domain = domains.ofCore(core_id);
+            std::lock_guard<std::mutex> domain_lock(domain.mtx);
+            if (proc && (core_quantum_used[core_id] >= time_quantum || groups.throttled(proc->group))) {
+                requeue(proc, domain);
+                proc = nullptr;
+            }
+            Process* next = proc ? nullptr : domain.ready.pop(groups, affinity, core_id, cycle);
+            if (next) {
+                proc = next;
+                core_quantum_used[core_id] = 0;
+                start_on_core(proc, core_id);
+                publish_domain(domain);
+                schedule_hash.store(CycleClock::hashDispatch(schedule_hash.load(std::memory_order_relaxed), cycle, core_id, proc->process_id), std::memory_order_relaxed);
+            }
+        }
+        if (proc && memory_manager) {
+            memory_manager->access(proc->process_id, proc->memory * proc->executed_commands.load(std::memory_order_relaxed) / proc->total_commands,
+                std::exchange(proc->cpu.stored, 0) != 0);
         }
     }
+    Tracer::setThreadCore(own_core);
+    publish_depths();
+    return true;
 }
+
 void RR_Scheduler::screen_ls() {
-    std::lock_guard<std::mutex> lock(mtx);
     //print_CPU_UTIL();
     //print_running_processes();
     //print_finished_processes();
     ReportUtil();
+    print_latency();
+
+    std::lock_guard<std::mutex> lock(mtx);
+    thread_local ReportRenderer report;
+    report.clear();
+    if (domains.size() > 1) {
+        domains.appendSummary(report);
+    }
+    if (groups.size() > 1 || groups.hasQuota()) {
+        std::vector<size_t> queued(groups.size(), 0);
+        domains.countQueued(queued);
+        groups.appendSummary(report, queued);
+    }
+    if (quantum_control.adaptive()) {
+        quantum_control.appendSummary(report, time_quantum.load(std::memory_order_relaxed), 5);
+    }
+    if (num_cores > 1) {
+        affinity.appendSummary(report, core_stats);
+    }
+    report.writeTo(std::cout);
 
 }
 
@@ -135,34 +813,194 @@ void RR_Scheduler::SetCpuCore(int cpu_core) {
     this->num_cores = cpu_core;
 }
 
+void RR_Scheduler::SetAffinity(Affinity::Layout layout) {
+    this->affinity_layout = layout;
+}
+
+void RR_Scheduler::SetMemoryManager(MemoryManager* manager) {
+    this->memory_manager = manager;
+}
+
+void RR_Scheduler::SetClock(const CycleClock::Settings& settings) {
+    this->clock_settings = settings;
+}
+
+void RR_Scheduler::SetCoreRuntime(bool coroutines, int threads) {
+    this->coroutine_cores = coroutines;
+    this->host_threads = threads;
+}
+
+void RR_Scheduler::SetSleepTick(std::chrono::steady_clock::duration tick) {
+    this->sleep_tick = std::max(tick, std::chrono::steady_clock::duration(1));
+}
+
+void RR_Scheduler::SetArrivalSource(ArrivalSource source, uint64_t stop_at_cycle) {
+    std::lock_guard<std::mutex> lock(mtx);
+    this->arrival_source = std::move(source);
+    this->stop_cycle = stop_at_cycle;
+}
+
+void RR_Scheduler::SetDomains(const std::string& spec, double threshold, int interval_ms) {
+    this->domain_spec = SchedulerDomains::parseSpec(spec);
+    this->balance_threshold = threshold;
+    this->balance_interval = std::chrono::milliseconds(std::max(1, interval_ms));
+}
+
+void RR_Scheduler::SetCpuGroups(const std::string& spec, int period_ms) {
+    std::vector<CpuGroups::Spec> specs;
+    if (CpuGroups::parse(spec, specs)) {
+        groups.configure(specs);
+    }
+    this->quota_period = std::chrono::milliseconds(std::max(1, period_ms));
+}
+
+void RR_Scheduler::SetSoftAffinity(int window_ms, int penalty_cycles) {
+    affinity.configure(std::chrono::milliseconds(window_ms), penalty_cycles);
+}
+
+size_t RR_Scheduler::getFinishedCount() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return finished_processes.size();
+}
+
+size_t RR_Scheduler::getPendingCount() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return pending_processes.size();
+}
+
+std::vector<double> RR_Scheduler::getTurnaroundTimes() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    std::vector<double> times;
+    times.reserve(finished_processes.size());
+    for (ProcessTable::Slot slot : finished_processes) {
+        const ProcessTable::Chunk& chunk = ProcessTable::chunk(slot);
+        ProcessTable::Slot row = ProcessTable::row(slot);
+        times.push_back(std::chrono::duration<double>(chunk.finish[row] - chunk.arrival[row]).count());
+    }
+    return times;
+}
+
+// Caller holds mtx. A new quota period let throttled CPU groups run again:
+// every core looks at its domain's queue once more.
+void RR_Scheduler::release_groups() {
+    for (size_t i = 0; i < domains.size(); ++i) {
+        SchedulerDomains::Domain& domain = domains[i];
+        std::lock_guard<std::mutex> domain_lock(domain.mtx);
+        if (domain.ready.runnable(groups)) {
+            notify_domain(domain, domain.cores.size());
+        }
+    }
+}
+
+// Caller holds mtx. Hands the adaptive controller the ready queues and the
+// cores' busy time so far, and publishes the quantum it picks. In lockstep
+// busy time is counted in cycles, so the inputs and the outcome depend only
+// on the cycle count.
+void RR_Scheduler::retune_quantum(double seconds) {
+    uint64_t busy_cycles = 0, busy_nanoseconds = 0;
+    for (const auto& stats : core_stats) {
+        if (!stats) continue;
+        busy_cycles += stats->busy_cycles.load(std::memory_order_relaxed);
+        busy_nanoseconds += stats->busy_nanoseconds.load(std::memory_order_relaxed);
+    }
+    int current = time_quantum.load(std::memory_order_relaxed);
+    int chosen = quantum_control.update(seconds, domains.depth(), num_cores, clock_settings.lockstep ? busy_cycles : busy_nanoseconds, busy_cycles, current);
+    if (chosen != current) {
+        time_quantum = chosen;
+        TRACE_EVENT(Tracer::Event::Quantum, 0, chosen);
+    }
+}
+
+// Caller holds mtx.
+void RR_Scheduler::publish_depths() {
+    backlog_depth.store(pending_processes.size(), std::memory_order_relaxed);
+    blocked_depth.store(sleepers.size(), std::memory_order_relaxed);
+    TRACE_EVENT(Tracer::Event::ReadyQueue, 0, static_cast<int64_t>(domains.depth()));
+}
+
+// Caller holds domain.mtx.
+void RR_Scheduler::publish_domain(SchedulerDomains::Domain& domain) {
+    domain.publish();
+    TRACE_EVENT(Tracer::Event::ReadyQueue, 0, static_cast<int64_t>(domains.depth()));
+}
+
+void RR_Scheduler::collectMetrics(MetricsWriter& out) const {
+    double uptime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+    appendCoreMetrics(out, core_stats, uptime);
+    out.family("csopesy_ready_queue_depth", "gauge", "Processes admitted and waiting for a core.");
+    std::lock_guard<std::mutex> lock(mtx); // Held only against start() repartitioning the domains
+    out.sample("csopesy_ready_queue_depth", static_cast<double>(domains.depth()));
+    out.family("csopesy_admission_backlog", "gauge", "Processes waiting for memory before admission.");
+    out.sample("csopesy_admission_backlog", static_cast<double>(backlog_depth.load(std::memory_order_relaxed)));
+    out.family("csopesy_blocked_processes", "gauge", "Processes sleeping in the timer wheel.");
+    out.sample("csopesy_blocked_processes", static_cast<double>(blocked_depth.load(std::memory_order_relaxed)));
+    appendLatencyMetrics(out, latency);
+    domains.collectMetrics(out);
+    groups.collectMetrics(out);
+    quantum_control.collectMetrics(out, time_quantum.load(std::memory_order_relaxed));
+    SoftAffinity::collectMetrics(out, core_stats);
+}
+
+void RR_Scheduler::fillDashboard(DashboardView& view) const {
+    view.cores.resize(core_stats.size());
+    for (size_t i = 0; i < core_stats.size(); ++i) {
+        view.cores[i].process.clear();
+        view.cores[i].host_cpu = core_stats[i] ? core_stats[i]->host_cpu : -1;
+        view.cores[i].busy_nanoseconds = core_stats[i] ? core_stats[i]->busy_nanoseconds.load(std::memory_order_relaxed) : 0;
+    }
+    view.backlog = backlog_depth.load(std::memory_order_relaxed);
+    view.blocked = blocked_depth.load(std::memory_order_relaxed);
+
+    std::lock_guard<std::mutex> lock(mtx);
+    std::list<Process*> running_processes;
+    domains.collectRunning(running_processes);
+    view.ready = domains.depth();
+    view.running = running_processes.size();
+    view.finished = finished_processes.size();
+    for (auto& proc : running_processes) {
+        if (proc->core_id < 0 || proc->core_id >= static_cast<int>(view.cores.size())) continue;
+        DashboardView::Core& core = view.cores[proc->core_id];
+        core.process.assign(proc->name);
+        core.executed = proc->executed_commands.load(std::memory_order_relaxed);
+        core.total = proc->total_commands;
+    }
+}
+
+void RR_Scheduler::SetTotalMemory(size_t memory) {
+    std::lock_guard<std::mutex> lock(mtx);
+    this->total_memory = memory;
+    this->free_memory = memory - used_memory;
+}
+
 void RR_Scheduler::SetQuantum(int quantum) {
     this->time_quantum = quantum;
 }
 
+void RR_Scheduler::SetAdaptiveQuantum(const QuantumController::Settings& settings) {
+    std::lock_guard<std::mutex> lock(mtx);
+    quantum_control.configure(settings);
+    timer_cv.notify_all(); // An idle timer thread starts updating it
+}
+
 bool RR_Scheduler::isValidProcessName(const std::string& process_name)
 {
     std::lock_guard<std::mutex> lock(mtx);
 
-    // Check process_queue
-    std::queue<Process*> temp_queue = process_queue;
-    while (!temp_queue.empty()) {
-        Process* proc = temp_queue.front();
-        temp_queue.pop();
-        if (proc->name == process_name) {
-            return false;
-        }
+    // Check the ready queues, core batches and running processes of every domain
+    if (domains.findIf([&](const Process* proc) { return proc->name == process_name; })) {
+        return false;
     }
 
-    // Check running_processes
-    for (auto& proc : running_processes) {
-        if (proc->name == process_name) {
-            return false;
-        }
+    // Check processes blocked in SLEEP
+    bool blocked = false;
+    sleepers.forEach([&](Process* proc) { blocked = blocked || proc->name == process_name; });
+    if (blocked) {
+        return false;
     }
 
     // Check finished_processes
-    for (auto& proc : finished_processes) {
-        if (proc->name == process_name) {
+    for (ProcessTable::Slot slot : finished_processes) {
+        if (ProcessTable::name(slot) == process_name) {
             return false;
         }
     }
@@ -171,85 +1009,76 @@ bool RR_Scheduler::isValidProcessName(const std::string& process_name)
 }
 
 void RR_Scheduler::ReportUtil() {
-    int numOfRunningProcess = running_processes.size();
-    int numOfFinishedProcess = finished_processes.size();
-
-    // Calculate CPU utilization as a percentage of used cores
-    int cpuUtilization = static_cast<int>((static_cast<double>(numOfRunningProcess) / num_cores) * 100);
+    thread_local ReportRenderer report;
+    report.clear();
 
-    std::vector<int> cores_used;
-    int total_executed_commands = 0;
-    int total_commands = 0;
+    // Linear pass over the process table columns; needs no lock
+    ProcessTable::Totals totals = ProcessTable::totals();
 
     {
         std::lock_guard<std::mutex> lock(mtx);
+        std::list<Process*> running_processes;
+        domains.collectRunning(running_processes);
 
-        for (auto& proc : running_processes) {
-            total_executed_commands += proc->executed_commands;
-            total_commands += proc->total_commands;
-
-            if (std::count(cores_used.begin(), cores_used.end(), proc->core_id) == 0) {
-                cores_used.push_back(proc->core_id);
-            }
+        // Render under the lock, write after releasing it
+        report.appendCpuSummary(num_cores, running_processes);
+        report.appendLatencySummary(latency);
+        report.append("Commands executed: ");
+        report.appendNumber(static_cast<long long>(totals.executed));
+        report.append(" / ");
+        report.appendNumber(static_cast<long long>(totals.total));
+        report.append("\n\n");
+        if (quantum_control.adaptive()) {
+            // Every change kept, so the log shows the quantum over time
+            quantum_control.appendSummary(report, time_quantum.load(std::memory_order_relaxed), QuantumController::HISTORY);
+            report.append("\n");
         }
-
-        for (auto& proc : finished_processes) {
-            total_executed_commands += proc->executed_commands;
-            total_commands += proc->total_commands;
+        if (num_cores > 1) {
+            affinity.appendSummary(report, core_stats);
+            report.append("\n");
         }
+        report.appendRunningProcesses(running_processes);
+        report.append("\n");
+        report.appendFinishedProcesses(finished_processes);
+        report.append("----------------\n\n");
     }
 
-    std::lock_guard<std::mutex> lock(mtx);
     std::ofstream log("csopesy-log.txt", std::ios::app);
-
-    log << "CPU Utilization: " << cpuUtilization << "%" << std::endl;
-    log << "Cores Used: " << cores_used.size() << std::endl;
-    log << "Cores Available: " << num_cores - cores_used.size() << std::endl;
-    log << "----------------\n";
-    log << "Running processes:\n";
-    for (auto& proc : running_processes) {
-        if (std::count(cores_used.begin(), cores_used.end(), proc->core_id) == 0) {
-            cores_used.push_back(proc->core_id);
-        }
-
-        log << proc->name << " (" << proc->get_start_time() << ") Core: "
-            << (proc->core_id == -1 ? "N/A" : std::to_string(proc->core_id))
-            << " " << proc->executed_commands << " / " << proc->total_commands << "\n";
-    }
-    log << std::endl;
-    log << "Finished processes:\n";
-    for (auto& proc : finished_processes) {
-        log << proc->name << " (" << proc->get_start_time() << ") Finished "
-            << proc->executed_commands << " / " << proc->total_commands << "\n";
-    }
-    log << "----------------\n";
-    log << std::endl;
+    report.writeTo(log);
     std::cout << "Report generated at /csopesy-log.txt" << std::endl;
 }
 
 
 void RR_Scheduler::print_running_processes() {
-
-    std::cout << "Running processes:\n";
-    for (auto& proc : running_processes) {
-        std::cout << proc->name << " (" << proc->get_start_time() << ") Core: "
-            << (proc->core_id == -1 ? "N/A" : std::to_string(proc->core_id))
-            << " " << proc->executed_commands << " / " << proc->total_commands << "\n";
-
+    thread_local ReportRenderer report;
+    report.clear();
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        std::list<Process*> running_processes;
+        domains.collectRunning(running_processes);
+        report.appendRunningProcesses(running_processes);
     }
-    std::cout << "----------------\n";
+    report.append("----------------\n");
+    report.writeTo(std::cout);
+}
+void RR_Scheduler::print_latency() {
+    thread_local ReportRenderer report;
+    report.clear();
+    report.appendLatencySummary(latency);
+    report.writeTo(std::cout);
 }
 void RR_Scheduler::print_finished_processes() {
-
-    std::cout << "Finished processes:\n";
-    for (auto& proc : finished_processes) {
-        std::cout << proc->name << " (" << proc->get_start_time() << ") Finished "
-            << proc->executed_commands << " / " << proc->total_commands << "\n";
+    thread_local ReportRenderer report;
+    report.clear();
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        report.appendFinishedProcesses(finished_processes);
     }
-    std::cout << "----------------\n";
+    report.append("----------------\n");
+    report.writeTo(std::cout);
 }
 void RR_Scheduler::print_CPU_UTIL() {
-    int numOfRunningProcess = running_processes.size();
+    int numOfRunningProcess = static_cast<int>(domains.runningCount());
     int cpuUtilization = static_cast<int>((static_cast<double>(numOfRunningProcess) / num_cores) * 100);
 
     std::cout << "CPU Utilization: " << cpuUtilization << "%\n";
@@ -263,42 +1092,36 @@ void RR_Scheduler::print_CPU_UTIL() {
 void RR_Scheduler::print_process_details(const std::string& process_name, int screen) {
     std::lock_guard<std::mutex> lock(mtx);
 
-    // Check process_queue
-    std::queue<Process*> temp_queue = process_queue;
-    while (!temp_queue.empty()) {
-        Process* proc = temp_queue.front();
-        temp_queue.pop();
-        if (proc->name == process_name) {
-            if (screen == 0) {
-                system("cls");
-            }
-
-            proc->displayProcessInfo();
-            return;
+    // Check the ready queues, core batches and running processes of every domain
+    Process* live = domains.findIf([&](const Process* proc) { return proc->name == process_name; });
+    if (live) {
+        if (screen == 0) {
+            clearConsole();
         }
+
+        live->displayProcessInfo();
+        return;
     }
 
-    // Check running_processes
-    for (auto& proc : running_processes) {
-        if (proc->name == process_name && screen == 0) {
-            system("cls");
-            proc->displayProcessInfo();
-            return;
-        }
-        else if (proc->name == process_name && screen == 1) {
-            proc->displayProcessInfo();
-            return;
+    // Check processes blocked in SLEEP
+    Process* blocked = nullptr;
+    sleepers.forEach([&](Process* proc) { if (proc->name == process_name) blocked = proc; });
+    if (blocked) {
+        if (screen == 0) {
+            clearConsole();
         }
+        blocked->displayProcessInfo();
+        return;
     }
 
     // Check finished_processes
-    for (auto& proc : finished_processes) {
-        if (proc->name == process_name && screen == 1) {
-            proc->displayProcessInfo();
+    for (ProcessTable::Slot slot : finished_processes) {
+        if (ProcessTable::name(slot) == process_name && screen == 1) {
+            Process::displayProcessInfo(slot);
             std::cout << "Process " << process_name << " has finished and cannot be accessed after exiting this screen.\n";
             return;
         }
-        else if (proc->name == process_name && screen == 0) {
+        else if (ProcessTable::name(slot) == process_name && screen == 0) {
             std::cout << "Process " << process_name << " not found.\n";
             return;
         }
@@ -308,3 +1131,90 @@ void RR_Scheduler::print_process_details(const std::string& process_name, int sc
     std::cout << "Process " << process_name << " not found.\n";
 }
 
+
+void RR_Scheduler::save(Checkpoint::Writer& out, std::chrono::steady_clock::time_point now) const {
+    std::lock_guard<std::mutex> lock(mtx);
+    std::vector<Process*> procs;
+    domains.forEachReady([&](Process* proc) { procs.push_back(proc); });
+    size_t ready = procs.size();
+    for (std::queue<Process*> waiting = pending_processes; !waiting.empty(); waiting.pop()) {
+        procs.push_back(waiting.front());
+    }
+    std::vector<uint64_t> blocked_ticks;
+    blocked_ticks.reserve(sleepers.size());
+    sleepers.forEachTimer([&](Process* proc, uint64_t expiry) {
+        procs.push_back(proc);
+        blocked_ticks.push_back(expiry - sleepers.now());
+    });
+
+    Process::save(out, procs, now);
+    out.add(Checkpoint::Section::Scheduler, Checkpoint::SchedulerState{ ready, pending_processes.size(), sleepers.size(), start_cycle, schedule_hash.load() });
+    out.add(Checkpoint::Section::SchedulerBlocked, std::move(blocked_ticks));
+    out.add(Checkpoint::Section::SchedulerFinished, finished_processes);
+}
+
+// Caller holds mtx, with the cores stopped. Deletes every queued, waiting
+// and sleeping process; after a stop no process is left on a core.
+void RR_Scheduler::drop_processes() {
+    for (size_t i = 0; i < domains.size(); ++i) {
+        SchedulerDomains::Domain& domain = domains[i];
+        std::lock_guard<std::mutex> domain_lock(domain.mtx);
+        domain.ready.forEach([](Process* proc) { delete proc; });
+        domain.ready.clear();
+        domain.publish();
+    }
+    for (; !pending_processes.empty(); pending_processes.pop()) delete pending_processes.front();
+    sleepers.forEach([](Process* proc) { delete proc; });
+    sleepers.clear();
+}
+
+void RR_Scheduler::clear() {
+    std::lock_guard<std::mutex> lock(mtx);
+    drop_processes();
+    used_memory = 0;
+    free_memory = total_memory;
+    start_cycle = 0;
+    schedule_hash = CycleClock::HASH_SEED;
+    publish_depths();
+}
+
+bool RR_Scheduler::load(const Checkpoint::Reader& in, std::chrono::steady_clock::time_point now) {
+    const Checkpoint::SchedulerState* state = in.record<Checkpoint::SchedulerState>(Checkpoint::Section::Scheduler);
+    auto blocked_ticks = in.section<uint64_t>(Checkpoint::Section::SchedulerBlocked);
+    auto finished = in.section<ProcessTable::Slot>(Checkpoint::Section::SchedulerFinished);
+    if (!state || blocked_ticks.size() != state->blocked) return false;
+    ProcessTable::Slot rows = ProcessTable::size();
+    if (std::any_of(finished.begin(), finished.end(), [&](ProcessTable::Slot slot) { return slot >= rows; })) return false;
+
+    std::vector<Process*> procs;
+    if (!Process::load(in, now, procs)) return false;
+    if (procs.size() != state->ready + state->pending + state->blocked) {
+        for (Process* proc : procs) delete proc;
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mtx);
+    drop_processes();
+
+    // Ready and blocked processes hold memory, waiting ones do not
+    used_memory = 0;
+    auto next = procs.begin();
+    for (uint64_t i = 0; i < state->ready; ++i, ++next) {
+        make_ready(domains.leastLoaded(), *next);
+        used_memory += (*next)->memory;
+    }
+    for (uint64_t i = 0; i < state->pending; ++i, ++next) {
+        pending_processes.push(*next);
+    }
+    for (uint64_t ticks : blocked_ticks) {
+        sleepers.schedule(*next, sleepers.now() + ticks);
+        used_memory += (*next)->memory;
+        ++next;
+    }
+    free_memory = used_memory < total_memory ? total_memory - used_memory : 0;
+    finished_processes.assign(finished.begin(), finished.end());
+    start_cycle = state->cycle;
+    schedule_hash = state->schedule_hash;
+    publish_depths();
+    return true;
+}
@@ -0,0 +1,110 @@
+#include "ReportRenderer.h"
+#include "Platform.h"
+#include <charconv>
+#include <utility>
+
+void ReportRenderer::appendNumber(long long value) {
+    char digits[24];
+    auto result = std::to_chars(digits, digits + sizeof(digits), value);
+    buffer.append(digits, result.ptr);
+}
+
+void ReportRenderer::appendFixed(double value, int precision, int width) {
+    char digits[32];
+    auto result = std::to_chars(digits, digits + sizeof(digits), value, std::chars_format::fixed, precision);
+    int length = static_cast<int>(result.ptr - digits);
+    if (length < width) {
+        buffer.append(static_cast<size_t>(width - length), ' ');
+    }
+    buffer.append(digits, result.ptr);
+}
+
+void ReportRenderer::appendTimestamp(std::chrono::system_clock::time_point time) {
+    std::time_t second = std::chrono::system_clock::to_time_t(time);
+    if (second != cached_second) {
+        std::tm local_tm = toLocalTime(second);
+        cached_length = std::strftime(cached_timestamp, sizeof(cached_timestamp), "%m/%d/%Y %I:%M:%S%p", &local_tm);
+        cached_second = second;
+    }
+    buffer.append(cached_timestamp, cached_length);
+}
+
+void ReportRenderer::appendCpuSummary(int num_cores, const std::list<Process*>& running_processes) {
+    int cpuUtilization = num_cores > 0 ? static_cast<int>((static_cast<double>(running_processes.size()) / num_cores) * 100) : 0;
+
+    core_seen.assign(num_cores > 0 ? num_cores : 0, false);
+    int cores_used = 0;
+    for (auto& proc : running_processes) {
+        if (proc->core_id >= 0 && proc->core_id < num_cores && !core_seen[proc->core_id]) {
+            core_seen[proc->core_id] = true;
+            ++cores_used;
+        }
+    }
+
+    append("CPU Utilization: ");
+    appendNumber(cpuUtilization);
+    append("%\nCores Used: ");
+    appendNumber(cores_used);
+    append("\nCores Available: ");
+    appendNumber(num_cores - cores_used);
+    append("\n----------------\n");
+}
+
+void ReportRenderer::appendRunningProcesses(const std::list<Process*>& processes) {
+    append("Running processes:\n");
+    for (auto& proc : processes) {
+        append(proc->name);
+        append(" (");
+        appendTimestamp(proc->start_time);
+        append(") Core: ");
+        if (proc->core_id == -1) {
+            append("N/A");
+        }
+        else {
+            appendNumber(proc->core_id);
+        }
+        append(" ");
+        appendNumber(proc->executed_commands.load(std::memory_order_relaxed));
+        append(" / ");
+        appendNumber(proc->total_commands);
+        append("\n");
+    }
+}
+
+void ReportRenderer::appendFinishedProcesses(const std::vector<ProcessTable::Slot>& slots) {
+    append("Finished processes:\n");
+    for (ProcessTable::Slot slot : slots) {
+        const ProcessTable::Chunk& chunk = ProcessTable::chunk(slot);
+        ProcessTable::Slot row = ProcessTable::row(slot);
+        append(chunk.name[row]);
+        append(" (");
+        appendTimestamp(chunk.start[row]);
+        append(") Finished ");
+        appendNumber(chunk.executed[row].load(std::memory_order_relaxed));
+        append(" / ");
+        appendNumber(chunk.total[row]);
+        append("\n");
+    }
+}
+
+void ReportRenderer::appendLatencySummary(const SchedulerLatency& latency) {
+    static constexpr double percentiles[] = { 50.0, 90.0, 99.0, 99.9 };
+    const std::pair<const char*, const LatencyHistogram*> rows[] = {
+        { "Waiting    ", &latency.waiting },
+        { "Response   ", &latency.response },
+        { "Turnaround ", &latency.turnaround },
+    };
+
+    append("Latency (ms)      p50       p90       p99     p99.9       max   count\n");
+    for (const auto& row : rows) {
+        append(row.first);
+        for (double p : percentiles) {
+            appendFixed(static_cast<double>(row.second->percentile(p)) / 1e6, 3, 10);
+        }
+        appendFixed(static_cast<double>(row.second->max()) / 1e6, 3, 10);
+        append("  ");
+        appendNumber(static_cast<long long>(row.second->count()));
+        append("\n");
+    }
+    append("----------------\n");
+}
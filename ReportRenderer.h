@@ -0,0 +1,43 @@
+#pragma once
+#include "LatencyHistogram.h"
+#include "Process.h"
+#include <chrono>
+#include <ctime>
+#include <list>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Renders scheduler reports into a reusable buffer and emits each report
+// with a single write. The buffer keeps its capacity between reports and
+// timestamps are formatted once per distinct second, so steady-state
+// rendering allocates nothing.
+class ReportRenderer {
+public:
+    void clear() { buffer.clear(); }
+    void append(std::string_view text) { buffer.append(text); }
+    void appendNumber(long long value);
+    void appendTimestamp(std::chrono::system_clock::time_point time);
+    // Right-aligned in `width` columns with `precision` decimals
+    void appendFixed(double value, int precision, int width);
+
+    // "CPU Utilization / Cores Used / Cores Available" header of a report
+    void appendCpuSummary(int num_cores, const std::list<Process*>& running_processes);
+    // "<name> (<start time>) Core: <core> <executed> / <total>" per process
+    void appendRunningProcesses(const std::list<Process*>& processes);
+    // "<name> (<start time>) Finished <executed> / <total>" per process
+    void appendFinishedProcesses(const std::vector<ProcessTable::Slot>& slots);
+    // p50/p90/p99/p99.9/max table (milliseconds) for waiting, response and turnaround
+    void appendLatencySummary(const SchedulerLatency& latency);
+
+    void writeTo(std::ostream& out) const { out.write(buffer.data(), static_cast<std::streamsize>(buffer.size())); out.flush(); }
+    const std::string& str() const { return buffer; }
+
+private:
+    std::string buffer;
+    std::vector<bool> core_seen;         // Scratch for counting distinct cores
+    std::time_t cached_second = -1;
+    char cached_timestamp[32] = {};
+    size_t cached_length = 0;
+};
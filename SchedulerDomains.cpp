@@ -0,0 +1,166 @@
+#include "SchedulerDomains.h"
+#include <cstdlib>
+#include <map>
+#include "Metrics.h"
+#include "Process.h"
+#include "ReportRenderer.h"
+
+SchedulerDomains::Spec SchedulerDomains::parseSpec(const std::string& value) {
+    Spec spec;
+    if (value == "numa") {
+        spec.numa = true;
+    }
+    else if (value != "none") {
+        spec.cores_per_domain = std::max(0, std::atoi(value.c_str()));
+    }
+    return spec;
+}
+
+SchedulerDomains::SchedulerDomains() {
+    domains.push_back(std::make_unique<Domain>());
+}
+
+void SchedulerDomains::partition(int num_cores, const Spec& spec, Affinity::Layout layout) {
+    // Domain index per core: by NUMA node in order of first appearance, or by group
+    std::vector<int> assignment(num_cores, 0);
+    std::map<int, int> node_domain;
+    for (int core = 0; core < num_cores; ++core) {
+        if (spec.numa) {
+            int node = Affinity::placeCore(core, layout).numa_node;
+            assignment[core] = node_domain.emplace(node, static_cast<int>(node_domain.size())).first->second;
+        }
+        else if (spec.cores_per_domain > 0) {
+            assignment[core] = core / spec.cores_per_domain;
+        }
+    }
+    size_t count = num_cores == 0 ? 1 : static_cast<size_t>(*std::max_element(assignment.begin(), assignment.end()) + 1);
+
+    if (count != domains.size()) {
+        // Deal the queued processes round the new domains, keeping their order
+        std::vector<Process*> queued;
+        for (const auto& domain : domains) {
+            domain->ready.forEach([&](Process* proc) { queued.push_back(proc); });
+        }
+        domains.clear();
+        for (size_t i = 0; i < count; ++i) {
+            domains.push_back(std::make_unique<Domain>());
+        }
+        for (size_t i = 0; i < queued.size(); ++i) {
+            domains[i % count]->ready.push(queued[i]);
+        }
+    }
+
+    core_domain = assignment;
+    core_slot.assign(num_cores, 0);
+    for (const auto& domain : domains) {
+        domain->cores.clear();
+    }
+    for (int core = 0; core < num_cores; ++core) {
+        Domain& domain = *domains[assignment[core]];
+        core_slot[core] = static_cast<int>(domain.cores.size());
+        domain.cores.push_back(core);
+    }
+    for (const auto& domain : domains) {
+        domain->batches.assign(domain->cores.size(), {});
+        domain->batched = 0;
+        domain->publish();
+    }
+}
+
+SchedulerDomains::Domain& SchedulerDomains::leastLoaded() {
+    Domain* least = domains.front().get();
+    for (const auto& domain : domains) {
+        if (domain->loadPerCore() < least->loadPerCore()) {
+            least = domain.get();
+        }
+    }
+    return *least;
+}
+
+size_t SchedulerDomains::depth() const {
+    size_t total = 0;
+    for (const auto& domain : domains) {
+        total += domain->depth.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+uint64_t SchedulerDomains::migrations() const {
+    uint64_t total = 0;
+    for (const auto& domain : domains) {
+        total += domain->migrated_in.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+void SchedulerDomains::collectRunning(std::list<Process*>& out) const {
+    for (const auto& domain : domains) {
+        std::lock_guard<std::mutex> lock(domain->mtx);
+        out.insert(out.end(), domain->running.begin(), domain->running.end());
+    }
+}
+
+size_t SchedulerDomains::runningCount() const {
+    size_t total = 0;
+    for (const auto& domain : domains) {
+        std::lock_guard<std::mutex> lock(domain->mtx);
+        total += domain->running.size();
+    }
+    return total;
+}
+
+void SchedulerDomains::countQueued(std::vector<size_t>& per_group) const {
+    for (const auto& domain : domains) {
+        std::lock_guard<std::mutex> lock(domain->mtx);
+        auto count = [&](Process* proc) {
+            size_t group = static_cast<size_t>(std::max(proc->group, 0));
+            if (group >= per_group.size()) per_group.resize(group + 1);
+            ++per_group[group];
+        };
+        domain->ready.forEach(count);
+        for (const auto& batch : domain->batches) {
+            for (Process* proc : batch) count(proc);
+        }
+    }
+}
+
+void SchedulerDomains::collectMetrics(MetricsWriter& out) const {
+    out.family("csopesy_domain_ready_depth", "gauge", "Processes queued in each scheduling domain.");
+    for (size_t i = 0; i < domains.size(); ++i) {
+        out.sample("csopesy_domain_ready_depth", "domain", static_cast<long long>(i), static_cast<double>(domains[i]->depth.load(std::memory_order_relaxed)));
+    }
+    out.family("csopesy_domain_migrations_in_total", "counter", "Processes the balancer moved into each scheduling domain.");
+    for (size_t i = 0; i < domains.size(); ++i) {
+        out.sample("csopesy_domain_migrations_in_total", "domain", static_cast<long long>(i), static_cast<double>(domains[i]->migrated_in.load(std::memory_order_relaxed)));
+    }
+    out.family("csopesy_domain_migrations_out_total", "counter", "Processes the balancer moved out of each scheduling domain.");
+    for (size_t i = 0; i < domains.size(); ++i) {
+        out.sample("csopesy_domain_migrations_out_total", "domain", static_cast<long long>(i), static_cast<double>(domains[i]->migrated_out.load(std::memory_order_relaxed)));
+    }
+}
+
+void SchedulerDomains::appendSummary(ReportRenderer& report) const {
+    report.append("Scheduling domains: ");
+    report.appendNumber(static_cast<long long>(domains.size()));
+    report.append(", migrations: ");
+    report.appendNumber(static_cast<long long>(migrations()));
+    report.append("\n");
+    for (size_t i = 0; i < domains.size(); ++i) {
+        const Domain& domain = *domains[i];
+        size_t queued = domain.depth.load(std::memory_order_relaxed);
+        size_t load = domain.load.load(std::memory_order_relaxed);
+        report.append("  Domain ");
+        report.appendNumber(static_cast<long long>(i));
+        report.append(": ");
+        report.appendNumber(static_cast<long long>(domain.cores.size()));
+        report.append(" cores, ");
+        report.appendNumber(static_cast<long long>(load > queued ? load - queued : 0));
+        report.append(" running, ");
+        report.appendNumber(static_cast<long long>(queued));
+        report.append(" ready, migrated in ");
+        report.appendNumber(static_cast<long long>(domain.migrated_in.load(std::memory_order_relaxed)));
+        report.append(" / out ");
+        report.appendNumber(static_cast<long long>(domain.migrated_out.load(std::memory_order_relaxed)));
+        report.append("\n");
+    }
+}
@@ -0,0 +1,192 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "Affinity.h"
+#include "CpuGroups.h"
+
+class Process;
+class MetricsWriter;
+class ReportRenderer;
+
+// Splits the emulated cores into scheduling domains, each with a ready queue,
+// run list and lock of its own, so a core that requeues a process and takes
+// the next one only contends with the cores of its domain. A domain is the
+// cores placed on one NUMA node or a fixed-size group of cores; a single
+// domain behaves like one shared ready queue. Processes stay in the domain
+// they were queued in until the balancer moves them.
+//
+// Lock order: the scheduler's own lock, then domain locks in index order.
+class SchedulerDomains {
+public:
+    struct Domain {
+        std::mutex mtx;
+        std::condition_variable cv;        // Its thread cores wait here for work
+        GroupQueue ready;                  // Per CPU group
+        std::list<Process*> running;
+        std::vector<std::deque<Process*>> batches; // Per core, in the order of `cores`: taken from ready, not dispatched yet
+        size_t batched = 0;                // Across batches
+        std::deque<std::coroutine_handle<>> idle_cores; // Coroutine cores parked until work arrives
+        std::vector<int> cores;            // Set by partition, with the cores stopped
+
+        // Mirrors for lock-free readers and the balancer, refreshed by publish()
+        std::atomic<size_t> depth{ 0 };    // Ready and batched
+        std::atomic<size_t> load{ 0 };     // Depth plus running
+        std::atomic<uint64_t> migrated_in{ 0 };
+        std::atomic<uint64_t> migrated_out{ 0 };
+
+        // Caller holds mtx.
+        void publish() {
+            size_t queued = ready.size() + batched;
+            depth.store(queued, std::memory_order_relaxed);
+            load.store(queued + running.size(), std::memory_order_relaxed);
+        }
+        double loadPerCore() const {
+            return static_cast<double>(load.load(std::memory_order_relaxed)) / static_cast<double>(std::max<size_t>(cores.size(), 1));
+        }
+    };
+
+    struct Spec {
+        bool numa = false;         // One domain per NUMA node the cores are placed on
+        int cores_per_domain = 0;  // Otherwise groups of this many cores; 0 for a single domain
+    };
+    // "none", "numa" or a core count; anything else is a single domain.
+    static Spec parseSpec(const std::string& value);
+
+    SchedulerDomains(); // A single domain, so processes can queue before the first partition
+
+    // Assigns the cores to domains. If the assignment changed, the processes
+    // queued in the old domains are dealt round the new ones in queue order.
+    // Caller holds the scheduler's lock, with the cores stopped.
+    void partition(int num_cores, const Spec& spec, Affinity::Layout layout);
+
+    size_t size() const { return domains.size(); }
+    Domain& operator[](size_t index) { return *domains[index]; }
+    const Domain& operator[](size_t index) const { return *domains[index]; }
+    Domain& ofCore(int core_id) { return *domains[core_domain[core_id]]; }
+    std::deque<Process*>& batchOf(int core_id) { return ofCore(core_id).batches[core_slot[core_id]]; }
+    // Domain of the core a process last ran on, or the least loaded one
+    Domain& home(int core_id) {
+        bool known = core_id >= 0 && core_id < static_cast<int>(core_domain.size());
+        return known ? ofCore(core_id) : leastLoaded();
+    }
+    // Lowest load per core, lowest index on ties
+    Domain& leastLoaded();
+
+    // One balancing round. Repeatedly takes the domain with the highest load
+    // per core that has queued processes and the one with the lowest, and
+    // moves processes from the tail of the first's ready queue (the ones that
+    // would wait longest there, from its longest group queue) to the second's while their loads per core
+    // differ by more than `threshold`, or while the second has idle cores.
+    // With `idle_only` only the latter counts. Only the two domains of a move
+    // are locked, and `wake(target, count)` runs with the target's lock held.
+    // Returns how many processes moved.
+    template <typename Wake>
+    size_t balance(double threshold, bool idle_only, Wake wake);
+
+    size_t depth() const; // Queued processes across all domains
+    uint64_t migrations() const;
+
+    // The rest lock each domain in turn; the caller holds the scheduler's lock.
+    // First ready, batched or running process matching `match`, or nullptr.
+    template <typename Match>
+    Process* findIf(Match match) const;
+    template <typename Visit>
+    void forEachReady(Visit visit) const; // Ready queues in domain order, group by group
+    void collectRunning(std::list<Process*>& out) const;
+    size_t runningCount() const;
+    void countQueued(std::vector<size_t>& per_group) const; // Ready and batched, per CPU group
+
+    void collectMetrics(MetricsWriter& out) const;       // Per-domain depth and migrations; reads only atomics
+    void appendSummary(ReportRenderer& report) const;    // One line per domain
+
+private:
+    std::vector<std::unique_ptr<Domain>> domains;
+    std::vector<int> core_domain; // Domain index per core
+    std::vector<int> core_slot;   // Position of each core in its domain's `cores`
+};
+
+template <typename Match>
+Process* SchedulerDomains::findIf(Match match) const {
+    for (const auto& domain : domains) {
+        std::lock_guard<std::mutex> lock(domain->mtx);
+        Process* found = nullptr;
+        domain->ready.forEach([&](Process* proc) {
+            if (!found && match(proc)) found = proc;
+        });
+        if (found) return found;
+        for (const auto& batch : domain->batches) {
+            for (Process* proc : batch) {
+                if (match(proc)) return proc;
+            }
+        }
+        for (Process* proc : domain->running) {
+            if (match(proc)) return proc;
+        }
+    }
+    return nullptr;
+}
+
+template <typename Visit>
+void SchedulerDomains::forEachReady(Visit visit) const {
+    for (const auto& domain : domains) {
+        std::lock_guard<std::mutex> lock(domain->mtx);
+        domain->ready.forEach(visit);
+    }
+}
+
+template <typename Wake>
+size_t SchedulerDomains::balance(double threshold, bool idle_only, Wake wake) {
+    size_t moved = 0;
+    for (size_t round = 0; round + 1 < domains.size(); ++round) {
+        Domain* busiest = nullptr;
+        Domain* idlest = nullptr;
+        for (const auto& domain : domains) {
+            if (domain->depth.load(std::memory_order_relaxed) > 0 && (!busiest || domain->loadPerCore() > busiest->loadPerCore())) {
+                busiest = domain.get();
+            }
+            if (!idlest || domain->loadPerCore() < idlest->loadPerCore()) {
+                idlest = domain.get();
+            }
+        }
+        if (!busiest || busiest == idlest) break;
+
+        // Both locks, lower index first
+        bool busiest_first = std::find_if(domains.begin(), domains.end(), [&](const auto& domain) { return domain.get() == busiest || domain.get() == idlest; })->get() == busiest;
+        std::unique_lock<std::mutex> first_lock(busiest_first ? busiest->mtx : idlest->mtx);
+        std::unique_lock<std::mutex> second_lock(busiest_first ? idlest->mtx : busiest->mtx);
+
+        size_t from_cores = std::max<size_t>(busiest->cores.size(), 1);
+        size_t to_cores = std::max<size_t>(idlest->cores.size(), 1);
+        size_t from_load = busiest->ready.size() + busiest->batched + busiest->running.size();
+        size_t to_load = idlest->ready.size() + idlest->batched + idlest->running.size();
+        double difference = static_cast<double>(from_load) / from_cores - static_cast<double>(to_load) / to_cores;
+
+        // Enough to even out the loads per core, or at least to fill the idle cores
+        size_t even = from_load * to_cores > to_load * from_cores ? (from_load * to_cores - to_load * from_cores) / (from_cores + to_cores) : 0;
+        size_t idle = to_load < to_cores ? to_cores - to_load : 0;
+        size_t count = idle_only || difference <= threshold ? idle : std::max(even, idle);
+        count = std::min(count, busiest->ready.size());
+        if (count == 0) break;
+
+        for (size_t i = 0; i < count; ++i) {
+            idlest->ready.push(busiest->ready.popBack());
+        }
+        busiest->migrated_out.fetch_add(count, std::memory_order_relaxed);
+        idlest->migrated_in.fetch_add(count, std::memory_order_relaxed);
+        busiest->publish();
+        idlest->publish();
+        wake(*idlest, count);
+        moved += count;
+    }
+    return moved;
+}
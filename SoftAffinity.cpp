@@ -0,0 +1,91 @@
+#include "SoftAffinity.h"
+#include <algorithm>
+#include "Metrics.h"
+#include "Process.h"
+#include "ReportRenderer.h"
+
+void SoftAffinity::configure(std::chrono::milliseconds window, int penalty_cycles) {
+    window_ms = std::max(window, std::chrono::milliseconds(0));
+    penalty = std::max(penalty_cycles, 0);
+}
+
+void SoftAffinity::setUnits(double units_per_second) {
+    window = static_cast<uint64_t>(static_cast<double>(window_ms.count()) * units_per_second / 1000);
+}
+
+bool SoftAffinity::warm(const Process& proc, int core, uint64_t now) const {
+    return proc.core_id == core && now - proc.off_core_since < window;
+}
+
+size_t SoftAffinity::choose(const std::deque<Process*>& queue, int core, uint64_t now) const {
+    if (window == 0) return 0;
+    size_t scan = std::min(queue.size(), SCAN);
+    for (size_t i = 0; i < scan; ++i) {
+        const Process& proc = *queue[i];
+        if (warm(proc, core, now)) return i;
+        if (now - proc.off_core_since >= window) break; // Waited long enough; nothing passes it
+    }
+    return 0;
+}
+
+void SoftAffinity::place(Process& proc, int core, CoreStats& stats) const {
+    if (proc.core_id < 0) return; // First dispatch: cold wherever it runs
+    if (proc.core_id == core) {
+        stats.home_dispatches.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    ++proc.migrations;
+    proc.stall_cycles = penalty;
+    stats.migrations_in.fetch_add(1, std::memory_order_relaxed);
+}
+
+int SoftAffinity::stall(Process& proc, int budget, CoreStats& stats) {
+    int stalled = std::min(proc.stall_cycles, std::max(budget, 1));
+    proc.stall_cycles -= stalled;
+    stats.stall_cycles.fetch_add(static_cast<uint64_t>(stalled), std::memory_order_relaxed);
+    return stalled;
+}
+
+void SoftAffinity::collectMetrics(MetricsWriter& out, const std::vector<std::unique_ptr<CoreStats>>& cores) {
+    out.family("csopesy_core_migrations_in_total", "counter", "Processes dispatched onto the core after last running on another one.");
+    for (size_t i = 0; i < cores.size(); ++i) {
+        if (!cores[i]) continue;
+        out.sample("csopesy_core_migrations_in_total", "core", static_cast<long long>(i), static_cast<double>(cores[i]->migrations_in.load(std::memory_order_relaxed)));
+    }
+    out.family("csopesy_core_home_dispatches_total", "counter", "Processes dispatched back onto the core they last ran on.");
+    for (size_t i = 0; i < cores.size(); ++i) {
+        if (!cores[i]) continue;
+        out.sample("csopesy_core_home_dispatches_total", "core", static_cast<long long>(i), static_cast<double>(cores[i]->home_dispatches.load(std::memory_order_relaxed)));
+    }
+    out.family("csopesy_core_migration_stall_cycles_total", "counter", "Cycles the core stalled refilling the cache for processes that migrated onto it.");
+    for (size_t i = 0; i < cores.size(); ++i) {
+        if (!cores[i]) continue;
+        out.sample("csopesy_core_migration_stall_cycles_total", "core", static_cast<long long>(i), static_cast<double>(cores[i]->stall_cycles.load(std::memory_order_relaxed)));
+    }
+}
+
+void SoftAffinity::appendSummary(ReportRenderer& report, const std::vector<std::unique_ptr<CoreStats>>& cores) const {
+    uint64_t migrations = 0, home = 0, stalled = 0;
+    for (const auto& stats : cores) {
+        if (!stats) continue;
+        migrations += stats->migrations_in.load(std::memory_order_relaxed);
+        home += stats->home_dispatches.load(std::memory_order_relaxed);
+        stalled += stats->stall_cycles.load(std::memory_order_relaxed);
+    }
+    report.append("Migrations: ");
+    report.appendNumber(static_cast<long long>(migrations));
+    report.append(", ");
+    report.appendNumber(static_cast<long long>(home));
+    report.append(" dispatches back on the last core, ");
+    report.appendNumber(static_cast<long long>(stalled));
+    report.append(" stall cycles (affinity window ");
+    report.appendNumber(static_cast<long long>(window_ms.count()));
+    report.append(" ms, penalty ");
+    report.appendNumber(penalty);
+    report.append(" cycles)\n  In per core:");
+    for (size_t i = 0; i < cores.size(); ++i) {
+        report.append(i == 0 ? " " : ", ");
+        report.appendNumber(static_cast<long long>(cores[i] ? cores[i]->migrations_in.load(std::memory_order_relaxed) : 0));
+    }
+    report.append("\n");
+}
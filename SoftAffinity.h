@@ -0,0 +1,64 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <vector>
+#include "CoreStats.h"
+
+class Process;
+class MetricsWriter;
+class ReportRenderer;
+
+// Soft core affinity with a simple cache-warmth model. A process's working
+// set stays warm in the cache of the core it last ran on for `window` after
+// it leaves that core. A core dispatching from its ready queue takes a
+// process that is warm on it ahead of the ones queued before it, but never
+// passes over a process that has been off a core for the window already, so
+// locality delays nobody by more than that; with a window of 0 dispatch is
+// plain queue order.
+//
+// A process placed on a core other than the one it last ran on migrates:
+// the ProcessTable counts it per process and CoreStats per core, and the
+// process stalls for `penalty` cycles refilling its working set before it
+// runs again. Stalled cycles count as busy time and against the quantum.
+//
+// Times are in the scheduler's units: nanoseconds when cores run free,
+// cycles in lockstep. Settings change only while the cores are stopped;
+// the per-process state is guarded by the lock of the domain the process
+// is queued or running in.
+class SoftAffinity {
+public:
+    static constexpr size_t SCAN = 8; // Ready processes a dispatch looks at for a warm one
+
+    // Before start
+    void configure(std::chrono::milliseconds window, int penalty_cycles);
+    // How many units make a second; at start
+    void setUnits(double units_per_second);
+
+    bool preferring() const { return window > 0; }
+
+    // Warm on `core` at `now`
+    bool warm(const Process& proc, int core, uint64_t now) const;
+    // Index into `queue` of the process `core` should take: the first one
+    // warm on it, among those at the head that may still be passed over,
+    // otherwise the head.
+    size_t choose(const std::deque<Process*>& queue, int core, uint64_t now) const;
+    // `proc` is about to run on `core`: counts a migration and sets the
+    // stall it pays for it, or counts a dispatch back on its last core.
+    // Before the scheduler records the new core.
+    void place(Process& proc, int core, CoreStats& stats) const;
+    // Stall cycles a step of up to `budget` cycles spends instead of running
+    static int stall(Process& proc, int budget, CoreStats& stats);
+
+    // Migrations, dispatches back on the last core and stall cycles, per core
+    static void collectMetrics(MetricsWriter& out, const std::vector<std::unique_ptr<CoreStats>>& cores);
+    // "Migrations: ..." with the per-core counts and settings
+    void appendSummary(ReportRenderer& report, const std::vector<std::unique_ptr<CoreStats>>& cores) const;
+
+private:
+    std::chrono::milliseconds window_ms{ 0 };
+    int penalty = 0;
+    uint64_t window = 0; // In units
+};
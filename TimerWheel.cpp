@@ -0,0 +1,72 @@
+#include "TimerWheel.h"
+#include <algorithm>
+
+void TimerWheel::schedule(Process* proc, uint64_t expiry) {
+    place({ std::max(expiry, current + 1), proc });
+    ++count;
+}
+
+// Level is the highest slot-sized digit in which expiry and the current tick
+// differ; timers beyond the top level's range wait in the top level and are
+// placed again when their slot comes round.
+void TimerWheel::place(const Timer& timer) {
+    uint64_t differ = timer.expiry ^ current;
+    int level = 0;
+    while (level < LEVELS - 1 && (differ >> ((level + 1) * SLOT_BITS)) != 0) {
+        ++level;
+    }
+    slots[level][(timer.expiry >> (level * SLOT_BITS)) & (SLOTS - 1)].push_back(timer);
+}
+
+void TimerWheel::advance(uint64_t tick, std::vector<Process*>& expired) {
+    while (current < tick) {
+        if (count == 0) {
+            current = tick; // Nothing to expire on the way
+            break;
+        }
+        ++current;
+
+        // Crossing into a new slot of a higher level hands its timers down
+        for (int level = 1; level < LEVELS; ++level) {
+            if ((current & ((uint64_t(1) << (level * SLOT_BITS)) - 1)) != 0) break;
+            cascading.swap(slots[level][(current >> (level * SLOT_BITS)) & (SLOTS - 1)]);
+            for (const Timer& timer : cascading) {
+                place(timer);
+            }
+            cascading.clear();
+        }
+
+        std::vector<Timer>& due = slots[0][current & (SLOTS - 1)];
+        for (const Timer& timer : due) {
+            expired.push_back(timer.proc);
+        }
+        count -= due.size();
+        due.clear();
+    }
+}
+
+void TimerWheel::rebase(uint64_t tick) {
+    if (tick == current) return;
+    std::vector<Timer> pending;
+    pending.reserve(count);
+    for (auto& level : slots) {
+        for (auto& slot : level) {
+            for (const Timer& timer : slot) {
+                pending.push_back({ timer.expiry - current + tick, timer.proc });
+            }
+            slot.clear();
+        }
+    }
+    current = tick;
+    for (const Timer& timer : pending) {
+        place(timer);
+    }
+}
+
+void TimerWheel::clear() {
+    for (auto& level : slots) {
+        for (auto& slot : level) slot.clear();
+    }
+    current = 0;
+    count = 0;
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class Process;
+
+// Hierarchical timer wheel for blocked processes. Four levels of 256 slots
+// cover 2^32 ticks; a timer sits in the lowest level whose slot range still
+// separates its expiry from the current tick and moves down a level each
+// time the wheel turns past the start of that slot. Inserting is O(1), and
+// advancing by one tick touches one level-0 slot plus, every 256 ticks, one
+// slot per higher level. Expiry order depends only on the sequence of
+// schedule and advance calls, so a wheel driven by the lockstep clock is
+// deterministic.
+//
+// Not synchronized; the scheduler guards it with its own lock.
+class TimerWheel {
+public:
+    static constexpr int LEVELS = 4;
+    static constexpr int SLOT_BITS = 8;
+    static constexpr uint64_t SLOTS = 1u << SLOT_BITS;
+
+    // Wakes `proc` at tick `expiry`; an expiry that is not in the future
+    // fires on the next tick.
+    void schedule(Process* proc, uint64_t expiry);
+
+    // Turns the wheel forward to `tick` and appends every process whose
+    // timer came due, earliest first.
+    void advance(uint64_t tick, std::vector<Process*>& expired);
+
+    // Moves the wheel's notion of the current tick to `tick`, keeping the
+    // ticks every pending timer has left. Used when the tick source restarts.
+    void rebase(uint64_t tick);
+    // Drops every timer and turns the wheel back to tick 0.
+    void clear();
+
+    uint64_t now() const { return current; }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    // Visits every pending process, in no particular order.
+    template <typename Visit>
+    void forEach(Visit visit) const {
+        for (const auto& level : slots) {
+            for (const auto& slot : level) {
+                for (const Timer& timer : slot) visit(timer.proc);
+            }
+        }
+    }
+    // Visits every pending process with the tick it expires at.
+    template <typename Visit>
+    void forEachTimer(Visit visit) const {
+        for (const auto& level : slots) {
+            for (const auto& slot : level) {
+                for (const Timer& timer : slot) visit(timer.proc, timer.expiry);
+            }
+        }
+    }
+
+private:
+    struct Timer {
+        uint64_t expiry;
+        Process* proc;
+    };
+
+    void place(const Timer& timer);
+
+    std::vector<Timer> slots[LEVELS][SLOTS];
+    std::vector<Timer> cascading; // Reused while a higher-level slot is redistributed
+    uint64_t current = 0;
+    size_t count = 0;
+};
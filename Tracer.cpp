@@ -0,0 +1,193 @@
+#include "Tracer.h"
+#include "ProcessTable.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+constexpr size_t RING_CAPACITY = 1 << 16; // Events per thread
+
+struct TraceRecord {
+    int64_t nanoseconds; // Since the tracer started
+    int32_t core;
+    int32_t process_id;
+    int64_t arg;
+    Tracer::Event event;
+};
+
+// Written only by its owning thread; the head is published after each record.
+struct Ring {
+    std::unique_ptr<TraceRecord[]> records{ new TraceRecord[RING_CAPACITY] };
+    std::atomic<uint64_t> head{ 0 };
+    std::atomic<uint64_t> epoch{ 0 }; // Tracer session the contents belong to
+};
+
+std::mutex rings_mtx;                       // Guards the ring list, not the rings
+std::vector<std::shared_ptr<Ring>> rings;   // Outlive their threads so late flushes still see them
+std::atomic<uint64_t> session{ 0 };
+std::atomic<std::chrono::steady_clock::rep> origin{ 0 }; // Session start, in steady_clock ticks
+
+thread_local std::shared_ptr<Ring> thread_ring;
+thread_local int thread_core = -1;
+
+const char* eventName(Tracer::Event event) {
+    switch (event) {
+    case Tracer::Event::Dispatch: return "dispatch";
+    case Tracer::Event::Preempt: return "preempt";
+    case Tracer::Event::Requeue: return "requeue";
+    case Tracer::Event::Finish: return "finish";
+    case Tracer::Event::Block: return "block";
+    case Tracer::Event::Wake: return "wake";
+    case Tracer::Event::PageIn: return "page-in";
+    case Tracer::Event::PageOut: return "page-out";
+    case Tracer::Event::ReadyQueue: return "ready_queue";
+    case Tracer::Event::Quantum: return "quantum";
+    }
+    return "event";
+}
+
+void appendJsonString(std::string& out, std::string_view text) {
+    out.push_back('"');
+    for (char c : text) {
+        if (c == '"' || c == '\\') out.push_back('\\');
+        if (static_cast<unsigned char>(c) >= 0x20) out.push_back(c);
+    }
+    out.push_back('"');
+}
+
+}
+
+std::atomic<bool> Tracer::enabled_{ false };
+
+void Tracer::start() {
+    {
+        std::lock_guard<std::mutex> lock(rings_mtx);
+        origin.store(std::chrono::steady_clock::now().time_since_epoch().count(), std::memory_order_relaxed);
+        session.fetch_add(1, std::memory_order_release);
+    }
+    enabled_.store(true, std::memory_order_release);
+}
+
+void Tracer::stop() {
+    enabled_.store(false, std::memory_order_release);
+}
+
+void Tracer::setThreadCore(int core_id) {
+    thread_core = core_id;
+}
+
+int Tracer::threadCore() {
+    return thread_core;
+}
+
+void Tracer::record(Event event, int process_id, int64_t arg) {
+    uint64_t current = session.load(std::memory_order_acquire);
+    if (!thread_ring) {
+        thread_ring = std::make_shared<Ring>();
+        std::lock_guard<std::mutex> lock(rings_mtx);
+        rings.push_back(thread_ring);
+    }
+    Ring& ring = *thread_ring;
+    uint64_t head = ring.head.load(std::memory_order_relaxed);
+    if (ring.epoch.load(std::memory_order_relaxed) != current) {
+        // First event of a new session: forget the previous one
+        ring.epoch.store(current, std::memory_order_relaxed);
+        head = 0;
+    }
+
+    TraceRecord& r = ring.records[head % RING_CAPACITY];
+    std::chrono::steady_clock::duration since(std::chrono::steady_clock::now().time_since_epoch().count() - origin.load(std::memory_order_relaxed));
+    r.nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(since).count();
+    r.core = thread_core;
+    r.process_id = process_id;
+    r.arg = arg;
+    r.event = event;
+    ring.head.store(head + 1, std::memory_order_release);
+}
+
+bool Tracer::writeJson(const std::string& path) {
+    std::ofstream file(path);
+    if (!file.is_open()) return false;
+
+    // Gather every ring of the current session in timestamp order
+    std::vector<TraceRecord> events;
+    {
+        std::lock_guard<std::mutex> lock(rings_mtx);
+        uint64_t current = session.load(std::memory_order_acquire);
+        for (const auto& ring : rings) {
+            if (ring->epoch.load(std::memory_order_relaxed) != current) continue;
+            uint64_t head = ring->head.load(std::memory_order_acquire);
+            // Skip the oldest slot too: a writer that saw tracing enabled just
+            // before stop() may still be overwriting it
+            uint64_t first = head >= RING_CAPACITY ? head - RING_CAPACITY + 1 : 0;
+            for (uint64_t i = first; i < head; ++i) {
+                events.push_back(ring->records[i % RING_CAPACITY]);
+            }
+        }
+    }
+    std::stable_sort(events.begin(), events.end(),
+        [](const TraceRecord& a, const TraceRecord& b) { return a.nanoseconds < b.nanoseconds; });
+
+    // Cores are threads of process 1; queue and memory activity off a core go on the scheduler track
+    int max_core = -1;
+    for (const auto& e : events) max_core = std::max(max_core, e.core);
+
+    std::string out;
+    out.reserve(events.size() * 96 + 256);
+    out.append("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    out.append("{\"ph\":\"M\",\"pid\":1,\"name\":\"process_name\",\"args\":{\"name\":\"csopesy\"}}");
+    out.append(",\n{\"ph\":\"M\",\"pid\":1,\"tid\":0,\"name\":\"thread_name\",\"args\":{\"name\":\"scheduler\"}}");
+    for (int core = 0; core <= max_core; ++core) {
+        out.append(",\n{\"ph\":\"M\",\"pid\":1,\"tid\":").append(std::to_string(core + 1))
+           .append(",\"name\":\"thread_name\",\"args\":{\"name\":\"core ").append(std::to_string(core)).append("\"}}");
+    }
+
+    char timestamp[32];
+    for (const auto& e : events) {
+        std::snprintf(timestamp, sizeof(timestamp), "%.3f", e.nanoseconds / 1000.0);
+        std::string tid = std::to_string(e.core + 1);
+        std::string_view name = e.process_id > 0 && static_cast<ProcessTable::Slot>(e.process_id) <= ProcessTable::size()
+            ? ProcessTable::name(static_cast<ProcessTable::Slot>(e.process_id - 1)) : std::string_view("?");
+
+        out.append(",\n{");
+        switch (e.event) {
+        case Event::Dispatch:
+            // Slices open on dispatch and close on preempt or finish
+            out.append("\"ph\":\"B\",\"name\":");
+            appendJsonString(out, name);
+            break;
+        case Event::Preempt:
+        case Event::Block:
+        case Event::Finish:
+            out.append("\"ph\":\"E\"");
+            break;
+        case Event::ReadyQueue:
+            out.append("\"ph\":\"C\",\"name\":\"ready_queue\",\"args\":{\"depth\":").append(std::to_string(e.arg)).append("}");
+            tid = "0";
+            break;
+        case Event::Quantum:
+            out.append("\"ph\":\"C\",\"name\":\"quantum\",\"args\":{\"cycles\":").append(std::to_string(e.arg)).append("}");
+            tid = "0";
+            break;
+        default:
+            out.append("\"ph\":\"i\",\"s\":\"t\",\"name\":\"").append(eventName(e.event)).append("\",\"args\":{\"process\":");
+            appendJsonString(out, name);
+            if (e.event == Event::PageIn || e.event == Event::PageOut) {
+                out.append(",\"page\":").append(std::to_string(e.arg));
+            }
+            out.append("}");
+            break;
+        }
+        out.append(",\"pid\":1,\"tid\":").append(tid).append(",\"ts\":").append(timestamp).append("}");
+    }
+    out.append("\n]}\n");
+
+    file.write(out.data(), static_cast<std::streamsize>(out.size()));
+    return file.good();
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// Optional scheduling timeline in Chrome trace-event format, loadable in
+// Perfetto or chrome://tracing. Each thread records into its own fixed-size
+// ring, so recording takes no lock; when a ring wraps the oldest events are
+// dropped. While tracing is off every call site costs one relaxed load and a
+// branch: use TRACE_EVENT rather than calling record() directly.
+class Tracer {
+public:
+    enum class Event : uint8_t {
+        Dispatch,   // Process placed on a core
+        Preempt,    // Quantum expired; process leaves the core
+        Requeue,    // Preempted process back in the ready queue
+        Finish,     // Process retired
+        Block,      // Process left its core to sleep; arg: ticks
+        Wake,       // Sleep timer expired; process back in the ready queue
+        PageIn,     // arg: page number
+        PageOut,    // arg: page number
+        ReadyQueue, // arg: ready queue depth (process_id unused)
+        Quantum     // arg: RR quantum in cycles the adaptive controller chose (process_id unused)
+    };
+
+    static bool enabled() { return enabled_.load(std::memory_order_relaxed); }
+
+    // Drops everything recorded so far and starts recording.
+    static void start();
+    // Stops recording. Events stay buffered until the next start().
+    static void stop();
+    // Writes the buffered events as trace-event JSON. False if the file cannot be opened.
+    static bool writeJson(const std::string& path);
+
+    // Core the calling thread emulates; tags its events. -1 (the default)
+    // puts them on the scheduler track.
+    static void setThreadCore(int core_id);
+    static int threadCore();
+
+    static void record(Event event, int process_id, int64_t arg = 0);
+
+private:
+    static std::atomic<bool> enabled_;
+};
+
+#define TRACE_EVENT(...) do { if (Tracer::enabled()) Tracer::record(__VA_ARGS__); } while (0)